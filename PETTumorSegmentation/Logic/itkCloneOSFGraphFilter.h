@@ -24,10 +24,10 @@ namespace itk
 {
 
 /** \class CloneOSFGraphFilter
- * \brief Create a deep copy of an OSFGraph.
+ * \brief Create a copy of an OSFGraph that behaves like a deep copy.
  * \date	12/9/2014
  * \author	Christian Bauer
- * Create a deep copy of an OSFGraph. CONTINUE
+ * Create a copy of an OSFGraph. Packed columns, nodes and edges are shared with the input and only copied when written.
  * Template parameters for class CloneOSFGraphFilter:
  *
  * - TOSFGraph = The graph type of the input to clone.
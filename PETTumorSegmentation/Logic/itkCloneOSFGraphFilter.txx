@@ -31,9 +31,9 @@ void
 CloneOSFGraphFilter<TOSFGraph>
 ::GenerateData()
 {
+  // copy-on-write: surfaces with packed columns, nodes and edges are only copied when a clone writes them
   this->CopyInputOSFGraphToOutputOSFGraphSurfaces();
-  this->CopyInputOSFGraphToOutputOSFGraphGraph();
-  this->GetOutput()->BuildGraphNodeIdentifierLookupTable();
+  this->GetOutput()->ShareNodesAndEdges( this->GetInput() );
 }
 
 //----------------------------------------------------------------------------
@@ -19,7 +19,10 @@
 #define _itkLOGISMOSOSFGraphSolverFilter_h
 
 #include "itkOSFGraphToOSFGraphFilter.h"
-#include "logismos_graph.hxx"
+#include "logismos_solver.hxx"
+#include "logismos_push_relabel.hxx"
+#include "logismos_pseudoflow.hxx"
+#include "logismos_implicit_push_relabel.hxx"
 
 namespace itk
 {
@@ -54,6 +57,65 @@ public:
   using OutputOSFGraphType = TOutputOSFGraph;
   using OutputOSFGraphPointer = typename OutputOSFGraphType::Pointer;
   
+  /** Engines available to compute the max flow. All engines compute a minimum cut of the same energy, but with float
+   * capacities the cuts may differ where residual capacities are close to zero: BoykovKolmogorov saturates residuals
+   * below epsilon, the other engines only residuals of exactly zero. The surface may then differ from the default. */
+  enum MaxFlowSolverEngineType
+  {
+    BoykovKolmogorov = 0, ///< augmenting paths on search trees (LOGISMOS::graph), supports ReuseSearchTrees
+    PushRelabel,          ///< highest-label push-relabel (LOGISMOS::push_relabel)
+    Pseudoflow,           ///< Hochbaum's pseudoflow, lowest label variant (LOGISMOS::pseudoflow)
+    ImplicitArcs          ///< push-relabel generating the edges from the column topology (LOGISMOS::implicit_push_relabel)
+  };
+
+  /** Select the engine used to compute the max flow, default is BoykovKolmogorov. */
+  itkSetMacro( MaxFlowSolverEngine, MaxFlowSolverEngineType );
+  itkGetMacro( MaxFlowSolverEngine, MaxFlowSolverEngineType );
+
+  /** Hard smoothness constraint and soft smoothness penalty the input graph was built with. Only used by the
+   * ImplicitArcs engine: it ignores the edges of the input and generates the intra-column and smoothness edges
+   * of SimpleOSFGraphBuilderFilter from the columns and the neighbor lookup table of the surfaces instead, so the
+   * graph builder can skip creating them (see SimpleOSFGraphBuilderFilter::CreateEdges). */
+  itkSetMacro( SmoothnessConstraint, unsigned int );
+  itkGetMacro( SmoothnessConstraint, unsigned int );
+  itkSetMacro( SoftSmoothnessPenalty, double );
+  itkGetMacro( SoftSmoothnessPenalty, double );
+
+  /** Store the edges of the max flow graph in one contiguous arena (CSR layout) instead of
+   * per-node chunk lists. The number of edges per node is counted before the edges are added.
+   * Only used by the BoykovKolmogorov engine, the other engines always use packed storage. */
+  itkSetMacro( PackedEdgeStorage, bool );
+  itkGetMacro( PackedEdgeStorage, bool );
+  itkBooleanMacro( PackedEdgeStorage );
+  
+  /** Keep the max flow graph with its flow and search trees alive after an update. If the next input has
+   * the same topology, only the capacity changes are applied and the max flow is continued from the
+   * previous solution (dynamic graph cuts) instead of being computed from scratch.
+   * Only used by engines supporting it (BoykovKolmogorov). */
+  itkSetMacro( ReuseSearchTrees, bool );
+  itkGetMacro( ReuseSearchTrees, bool );
+  itkBooleanMacro( ReuseSearchTrees );
+  
+  /** Keep the max flow graph allocated after an update. If the next input has the same topology and its solution
+   * is not continued (see ReuseSearchTrees), flow, search trees and capacities are reset in place and the capacities
+   * of the input are set again instead of allocating all nodes and edges.
+   * Only used by engines supporting it (BoykovKolmogorov). */
+  itkSetMacro( KeepMaxFlowGraph, bool );
+  itkGetMacro( KeepMaxFlowGraph, bool );
+  itkBooleanMacro( KeepMaxFlowGraph );
+  
+  /** Returns true if the last update continued from the previous solution and only updated the terminal capacities
+   * of the nodes of the dirty columns of the input surfaces. This requires the input to share the edges of the
+   * previous input, as an input updated from the previous one by SimpleOSFGraphBuilderFilter::UpdateDirtyColumnsOnly
+   * does; its dirty columns then are the only columns whose nodes changed. */
+  itkGetConstMacro( DirtyColumnsUpdated, bool );
+
+  /** Returns true if the last update continued from the previous solution. */
+  itkGetConstMacro( SearchTreesReused, bool );
+  
+  /** Returns true if the last update reset the kept max flow graph instead of building a new one. */
+  itkGetConstMacro( MaxFlowGraphReset, bool );
+  
 protected:
   /** Constructor for use by New() method. */
   LOGISMOSOSFGraphSolverFilter() = default;
@@ -63,13 +125,39 @@ protected:
   void GenerateData() override;
   
   using CapacityType = typename InputOSFGraphType::GraphCosts;
-  using MaxFlowGraphType = LOGISMOS::graph<CapacityType>;
+  using MaxFlowGraphType = LOGISMOS::solver<CapacityType>;
   using MaxFlowGraphPointer = MaxFlowGraphType*;
   MaxFlowGraphPointer m_MaxFlowGraph{ nullptr };
+  MaxFlowSolverEngineType m_MaxFlowGraphEngine{ BoykovKolmogorov }; // engine m_MaxFlowGraph was created for
   CapacityType m_FlowValue{ 0 };
+  MaxFlowSolverEngineType m_MaxFlowSolverEngine{ BoykovKolmogorov };
+  unsigned int m_SmoothnessConstraint{ itk::NumericTraits<unsigned int>::max() };
+  double m_SoftSmoothnessPenalty{ 0 };
+  bool m_PackedEdgeStorage{ true };
+  bool m_ReuseSearchTrees{ false };
+  bool m_SearchTreesReused{ false };
+  bool m_KeepMaxFlowGraph{ false };
+  bool m_MaxFlowGraphReset{ false };
+  bool m_DirtyColumnsUpdated{ false };
+  virtual MaxFlowGraphPointer CreateMaxFlowGraph() const;
   virtual void BuildMaxFlowGraphGraph();
+  virtual void BuildImplicitMaxFlowGraph();
+  virtual bool UpdateMaxFlowGraphCapacities();
+  virtual bool UpdateMaxFlowGraphCapacitiesOfDirtyColumns();
+  virtual bool ResetMaxFlowGraph();
   virtual void UpdateResult();
   
+  // capacities and topology the current max flow graph was built or last updated with (only kept for reuse or reset)
+  std::vector<CapacityType> m_SourceCapacities;
+  std::vector<CapacityType> m_SinkCapacities;
+  std::vector<CapacityType> m_EdgeCapacities;
+  std::vector<CapacityType> m_EdgeReverseCapacities;
+  std::size_t m_EdgeTopologyHash{ 0 };
+  typename InputOSFGraphType::GraphEdgesContainer::ConstPointer m_Edges; // edges of the input the capacities were kept for
+  static std::size_t HashEdge(std::size_t hash, std::size_t startNodeId, std::size_t endNodeId);
+  static bool IsCapacityChangeSupported(CapacityType capacity, CapacityType previousCapacity);
+  static CapacityType GetCapacityChange(CapacityType capacity, CapacityType previousCapacity);
+  
 private:
   
 }; // end class LOGISMOSOSFGraphSolverFilter
@@ -19,6 +19,8 @@ limitations under the License.
 #define _itkLOGISMOSOSFGraphSolverFilter_txx
 
 #include "itkLOGISMOSOSFGraphSolverFilter.h"
+#include <cmath>
+#include <limits>
 
 namespace itk
 {
@@ -42,19 +44,65 @@ LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
 ::GenerateData()
 {
   this->CopyInputOSFGraphToOutputOSFGraphSurfaces();
-  this->CopyInputOSFGraphToOutputOSFGraphGraph();
+  this->GetOutput()->ShareNodesAndEdges( this->GetInput() ); // the solution only changes the surfaces
   InputOSFGraphConstPointer input = this->GetInput();
-  // build graph
-  m_MaxFlowGraph = new MaxFlowGraphType();
 
-  this->BuildMaxFlowGraphGraph();
-  // solve max flow
-  m_FlowValue = m_MaxFlowGraph->solve();
+  // continue from the previous solution if only capacities changed
+  m_DirtyColumnsUpdated = m_ReuseSearchTrees && this->UpdateMaxFlowGraphCapacitiesOfDirtyColumns();
+  m_SearchTreesReused = m_DirtyColumnsUpdated || (m_ReuseSearchTrees && this->UpdateMaxFlowGraphCapacities());
+  m_MaxFlowGraphReset = false;
+  if (m_SearchTreesReused)
+  {
+    m_FlowValue = m_MaxFlowGraph->resolve();
+  }
+  else
+  {
+    // reset the kept graph if the topology did not change, build graph otherwise
+    m_MaxFlowGraphReset = m_KeepMaxFlowGraph && this->ResetMaxFlowGraph();
+    if (!m_MaxFlowGraphReset)
+    {
+      delete m_MaxFlowGraph;
+      m_MaxFlowGraph = this->CreateMaxFlowGraph();
+      m_MaxFlowGraphEngine = m_MaxFlowSolverEngine;
+
+      this->BuildMaxFlowGraphGraph();
+    }
+    // solve max flow
+    m_FlowValue = m_MaxFlowGraph->solve();
+  }
 
   // store result
   this->UpdateResult();
-  delete m_MaxFlowGraph;
-  m_MaxFlowGraph = nullptr;
+  if (!m_ReuseSearchTrees && !m_KeepMaxFlowGraph)
+  {
+    delete m_MaxFlowGraph;
+    m_MaxFlowGraph = nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+typename LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>::MaxFlowGraphPointer
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::CreateMaxFlowGraph() const
+{
+  switch (m_MaxFlowSolverEngine)
+  {
+    case PushRelabel:
+      return new LOGISMOS::push_relabel<CapacityType>();
+    case Pseudoflow:
+      return new LOGISMOS::pseudoflow<CapacityType>();
+    case ImplicitArcs:
+    {
+      std::size_t maxDiff = std::numeric_limits<std::size_t>::max();
+      if (m_SmoothnessConstraint!=itk::NumericTraits<unsigned int>::max())
+        maxDiff = m_SmoothnessConstraint;
+      return new LOGISMOS::implicit_push_relabel<CapacityType>( maxDiff, CapacityType(m_SoftSmoothnessPenalty) );
+    }
+    case BoykovKolmogorov:
+    default:
+      return new LOGISMOS::bk_solver<CapacityType>(m_PackedEdgeStorage);
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -63,6 +111,12 @@ void
 LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
 ::BuildMaxFlowGraphGraph()
 {
+  if (m_MaxFlowGraphEngine==ImplicitArcs)
+  {
+    this->BuildImplicitMaxFlowGraph();
+    return;
+  }
+
   // add nodes with terminal weights
   using GraphNodeContainer = typename InputOSFGraphType::GraphNodesContainer;
   typename GraphNodeContainer::ConstPointer graphNodes = this->GetInput()->GetNodes();
@@ -79,18 +133,305 @@ LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
     ++graphNodesItr;
   }
 
+  // remember capacities and topology to allow later updates
+  m_SourceCapacities.clear();
+  m_SinkCapacities.clear();
+  m_EdgeCapacities.clear();
+  m_EdgeReverseCapacities.clear();
+  m_EdgeTopologyHash = 0;
+  m_Edges = nullptr;
+  const bool keepCapacities = (m_ReuseSearchTrees && m_MaxFlowGraph->supports_reuse()) || (m_KeepMaxFlowGraph && m_MaxFlowGraph->supports_reset());
+  if (keepCapacities)
+  {
+    m_SourceCapacities.reserve( graphNodes->Size() );
+    m_SinkCapacities.reserve( graphNodes->Size() );
+    for (graphNodesItr = graphNodes->Begin(); graphNodesItr!=graphNodesEnd; ++graphNodesItr)
+    {
+      m_SourceCapacities.push_back( graphNodesItr.Value().cap_source );
+      m_SinkCapacities.push_back( graphNodesItr.Value().cap_sink );
+    }
+  }
+
   // add edges
   using GraphEdgesContainer = typename InputOSFGraphType::GraphEdgesContainer;
   typename GraphEdgesContainer::ConstPointer graphEdges = this->GetInput()->GetEdges();
   typename GraphEdgesContainer::ConstIterator graphEdgesItr = graphEdges->Begin();
   typename GraphEdgesContainer::ConstIterator graphEdgesEnd = graphEdges->End();
+  if ( m_MaxFlowGraph->counts_edges() )
+  {
+    // count edges per node first, so all edges fit into one arena
+    for ( ; graphEdgesItr!=graphEdgesEnd; ++graphEdgesItr )
+      m_MaxFlowGraph->count_edge( graphEdgesItr.Value().startNodeId, graphEdgesItr.Value().endNodeId );
+    m_MaxFlowGraph->allocate_edges();
+    graphEdgesItr = graphEdges->Begin();
+  }
   while ( graphEdgesItr!=graphEdgesEnd )
   {
     const typename InputOSFGraphType::GraphEdge& edge = graphEdgesItr.Value();
     m_MaxFlowGraph->add_edge( edge.startNodeId, edge.endNodeId, edge.cap, edge.rev_cap );
+    if (keepCapacities)
+    {
+      m_EdgeCapacities.push_back( edge.cap );
+      m_EdgeReverseCapacities.push_back( edge.rev_cap );
+      m_EdgeTopologyHash = HashEdge( m_EdgeTopologyHash, edge.startNodeId, edge.endNodeId );
+    }
     ++graphEdgesItr;
   }
+  if (keepCapacities)
+    m_Edges = graphEdges;
+
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+void
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::BuildImplicitMaxFlowGraph()
+{
+  using ImplicitMaxFlowGraphType = LOGISMOS::implicit_push_relabel<CapacityType>;
+  ImplicitMaxFlowGraphType* maxFlowGraph = static_cast<ImplicitMaxFlowGraphType*>( m_MaxFlowGraph );
+  InputOSFGraphConstPointer input = this->GetInput();
+
+  // the nodes of a column have to be consecutive and ordered by column position, as created by the graph builder
+  using GraphNodeContainer = typename InputOSFGraphType::GraphNodesContainer;
+  typename GraphNodeContainer::ConstPointer graphNodes = input->GetNodes();
+  std::vector< std::vector<std::size_t> > columnIds( input->GetNumberOfSurfaces() );
+  for (typename InputOSFGraphType::SurfaceIdentifier surfaceId=0; surfaceId<input->GetNumberOfSurfaces(); surfaceId++)
+    columnIds[surfaceId].resize( input->GetSurface(surfaceId)->GetNumberOfVertices(), std::numeric_limits<std::size_t>::max() );
+  typename GraphNodeContainer::ConstIterator graphNodesItr = graphNodes->Begin();
+  while ( graphNodesItr!=graphNodes->End() )
+  {
+    const typename InputOSFGraphType::GraphNode& firstNode = graphNodesItr.Value();
+    std::size_t columnSize = 0;
+    while ( graphNodesItr!=graphNodes->End() && graphNodesItr.Value().surfaceId==firstNode.surfaceId && graphNodesItr.Value().vertexId==firstNode.vertexId )
+    {
+      if (graphNodesItr.Value().positionId!=columnSize)
+        itkExceptionMacro(<< "Nodes of surface " << firstNode.surfaceId << " vertex " << firstNode.vertexId << " are not ordered by column position.");
+      ++columnSize;
+      ++graphNodesItr;
+    }
+    if (firstNode.surfaceId>=columnIds.size() || firstNode.vertexId>=columnIds[firstNode.surfaceId].size())
+      itkExceptionMacro(<< "Node of unknown surface " << firstNode.surfaceId << " vertex " << firstNode.vertexId << ".");
+    columnIds[firstNode.surfaceId][firstNode.vertexId] = maxFlowGraph->add_column( columnSize );
+  }
+
+  // neighborhood of the columns
+  for (typename InputOSFGraphType::SurfaceIdentifier surfaceId=0; surfaceId<input->GetNumberOfSurfaces(); surfaceId++)
+  {
+    typename InputOSFGraphType::OSFSurface::ConstPointer surface = input->GetSurface(surfaceId);
+    for (typename InputOSFGraphType::VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+    {
+      if (columnIds[surfaceId][vertexId]==std::numeric_limits<std::size_t>::max())
+        continue;
+      using VertexIdentifierContainer = typename InputOSFGraphType::OSFSurface::VertexIdentifierContainer;
+      typename VertexIdentifierContainer::ConstPointer neighbors = surface->GetNeighbors(vertexId);
+      if (!neighbors)
+        itkExceptionMacro(<< "The neighbor lookup table of surface " << surfaceId << " has to be built.");
+      for (typename VertexIdentifierContainer::ConstIterator neighborItr=neighbors->Begin(); neighborItr!=neighbors->End(); ++neighborItr)
+        if (columnIds[surfaceId][neighborItr.Value()]!=std::numeric_limits<std::size_t>::max())
+          maxFlowGraph->add_column_neighbor( columnIds[surfaceId][vertexId], columnIds[surfaceId][neighborItr.Value()] );
+    }
+  }
+
+  // terminal weights
+  for (graphNodesItr = graphNodes->Begin(); graphNodesItr!=graphNodes->End(); ++graphNodesItr)
+    maxFlowGraph->add_st_edge( graphNodesItr.Index(), graphNodesItr.Value().cap_source, graphNodesItr.Value().cap_sink );
+  maxFlowGraph->allocate_edges();
+
+  // capacities are not kept, the engine does not support reuse
+  m_SourceCapacities.clear();
+  m_SinkCapacities.clear();
+  m_EdgeCapacities.clear();
+  m_EdgeReverseCapacities.clear();
+  m_EdgeTopologyHash = 0;
+  m_Edges = nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+bool
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::UpdateMaxFlowGraphCapacities()
+{
+  // returns false if the existing max flow graph cannot be updated to match the input
+  if (m_MaxFlowGraph==nullptr || m_MaxFlowGraphEngine!=m_MaxFlowSolverEngine || !m_MaxFlowGraph->supports_reuse())
+    return false;
+
+  using GraphNodeContainer = typename InputOSFGraphType::GraphNodesContainer;
+  using GraphEdgesContainer = typename InputOSFGraphType::GraphEdgesContainer;
+  typename GraphNodeContainer::ConstPointer graphNodes = this->GetInput()->GetNodes();
+  typename GraphEdgesContainer::ConstPointer graphEdges = this->GetInput()->GetEdges();
+  if (graphNodes->Size()!=m_SourceCapacities.size() || graphEdges->Size()!=m_EdgeCapacities.size())
+    return false;
 
+  // topology has to be identical, infinite capacities have to stay unchanged
+  std::size_t edgeTopologyHash = 0;
+  for (typename GraphEdgesContainer::ConstIterator graphEdgesItr = graphEdges->Begin(); graphEdgesItr!=graphEdges->End(); ++graphEdgesItr)
+  {
+    const typename InputOSFGraphType::GraphEdge& edge = graphEdgesItr.Value();
+    edgeTopologyHash = HashEdge( edgeTopologyHash, edge.startNodeId, edge.endNodeId );
+    const std::size_t edgeId = graphEdgesItr.Index();
+    if ( !IsCapacityChangeSupported(edge.cap, m_EdgeCapacities[edgeId]) || !IsCapacityChangeSupported(edge.rev_cap, m_EdgeReverseCapacities[edgeId]) )
+      return false;
+  }
+  if (edgeTopologyHash!=m_EdgeTopologyHash)
+    return false;
+  for (typename GraphNodeContainer::ConstIterator graphNodesItr = graphNodes->Begin(); graphNodesItr!=graphNodes->End(); ++graphNodesItr)
+  {
+    const std::size_t nodeId = graphNodesItr.Index();
+    if ( !IsCapacityChangeSupported(graphNodesItr.Value().cap_source, m_SourceCapacities[nodeId]) || !IsCapacityChangeSupported(graphNodesItr.Value().cap_sink, m_SinkCapacities[nodeId]) )
+      return false;
+  }
+
+  // apply capacity changes
+  for (typename GraphNodeContainer::ConstIterator graphNodesItr = graphNodes->Begin(); graphNodesItr!=graphNodes->End(); ++graphNodesItr)
+  {
+    const typename InputOSFGraphType::GraphNode& node = graphNodesItr.Value();
+    const std::size_t nodeId = graphNodesItr.Index();
+    if (node.cap_source!=m_SourceCapacities[nodeId] || node.cap_sink!=m_SinkCapacities[nodeId])
+    {
+      m_MaxFlowGraph->update_st_edge( nodeId, GetCapacityChange(node.cap_source, m_SourceCapacities[nodeId]), GetCapacityChange(node.cap_sink, m_SinkCapacities[nodeId]) );
+      m_SourceCapacities[nodeId] = node.cap_source;
+      m_SinkCapacities[nodeId] = node.cap_sink;
+    }
+  }
+  for (typename GraphEdgesContainer::ConstIterator graphEdgesItr = graphEdges->Begin(); graphEdgesItr!=graphEdges->End(); ++graphEdgesItr)
+  {
+    const typename InputOSFGraphType::GraphEdge& edge = graphEdgesItr.Value();
+    const std::size_t edgeId = graphEdgesItr.Index();
+    if (edge.cap!=m_EdgeCapacities[edgeId] || edge.rev_cap!=m_EdgeReverseCapacities[edgeId])
+    {
+      // edges were added in order, each add_edge() call adds a pair of directed edges
+      m_MaxFlowGraph->update_edge( 2*edgeId, GetCapacityChange(edge.cap, m_EdgeCapacities[edgeId]), GetCapacityChange(edge.rev_cap, m_EdgeReverseCapacities[edgeId]) );
+      m_EdgeCapacities[edgeId] = edge.cap;
+      m_EdgeReverseCapacities[edgeId] = edge.rev_cap;
+    }
+  }
+  m_Edges = graphEdges;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+bool
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::UpdateMaxFlowGraphCapacitiesOfDirtyColumns()
+{
+  // returns false if the input does not share the edges of the previous input or does not track its dirty columns
+  if (m_MaxFlowGraph==nullptr || m_MaxFlowGraphEngine!=m_MaxFlowSolverEngine || !m_MaxFlowGraph->supports_reuse())
+    return false;
+
+  InputOSFGraphConstPointer input = this->GetInput();
+  if (m_Edges.IsNull() || input->GetEdges()!=m_Edges.GetPointer() || input->GetNumberOfNodes()!=m_SourceCapacities.size())
+    return false;
+  for (typename InputOSFGraphType::SurfaceIdentifier surfaceId=0; surfaceId<input->GetNumberOfSurfaces(); surfaceId++)
+    if (!input->GetSurface(surfaceId)->GetDirtyColumnsTracked())
+      return false;
+
+  // shared edges are copied before they are written, so only the terminal capacities of the dirty columns can differ
+  for (typename InputOSFGraphType::SurfaceIdentifier surfaceId=0; surfaceId<input->GetNumberOfSurfaces(); surfaceId++)
+  {
+    typename InputOSFGraphType::OSFSurface::ConstPointer surface = input->GetSurface(surfaceId);
+    for (typename InputOSFGraphType::VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+    {
+      const std::size_t numColumnPositions = surface->GetColumnCostsSpan(vertexId).size();
+      if (!surface->GetColumnCostsDirty(vertexId) || numColumnPositions==0)
+        continue;
+      const std::size_t firstNodeId = input->GetNodeIdentifer(surfaceId, vertexId, 0);
+      for (std::size_t nodeId=firstNodeId; nodeId<firstNodeId+numColumnPositions; nodeId++)
+      {
+        const typename InputOSFGraphType::GraphNode& node = input->GetNode(nodeId);
+        if ( !IsCapacityChangeSupported(node.cap_source, m_SourceCapacities[nodeId]) || !IsCapacityChangeSupported(node.cap_sink, m_SinkCapacities[nodeId]) )
+          return false; // the kept capacities match the changes applied so far, so the caller can still update or rebuild
+        if (node.cap_source!=m_SourceCapacities[nodeId] || node.cap_sink!=m_SinkCapacities[nodeId])
+        {
+          m_MaxFlowGraph->update_st_edge( nodeId, GetCapacityChange(node.cap_source, m_SourceCapacities[nodeId]), GetCapacityChange(node.cap_sink, m_SinkCapacities[nodeId]) );
+          m_SourceCapacities[nodeId] = node.cap_source;
+          m_SinkCapacities[nodeId] = node.cap_sink;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+bool
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::ResetMaxFlowGraph()
+{
+  // returns false if the existing max flow graph does not have the topology of the input
+  if (m_MaxFlowGraph==nullptr || m_MaxFlowGraphEngine!=m_MaxFlowSolverEngine || !m_MaxFlowGraph->supports_reset())
+    return false;
+
+  using GraphNodeContainer = typename InputOSFGraphType::GraphNodesContainer;
+  using GraphEdgesContainer = typename InputOSFGraphType::GraphEdgesContainer;
+  typename GraphNodeContainer::ConstPointer graphNodes = this->GetInput()->GetNodes();
+  typename GraphEdgesContainer::ConstPointer graphEdges = this->GetInput()->GetEdges();
+  if (graphNodes->Size()!=m_SourceCapacities.size() || graphEdges->Size()!=m_EdgeCapacities.size())
+    return false;
+
+  std::size_t edgeTopologyHash = 0;
+  for (typename GraphEdgesContainer::ConstIterator graphEdgesItr = graphEdges->Begin(); graphEdgesItr!=graphEdges->End(); ++graphEdgesItr)
+    edgeTopologyHash = HashEdge( edgeTopologyHash, graphEdgesItr.Value().startNodeId, graphEdgesItr.Value().endNodeId );
+  if (edgeTopologyHash!=m_EdgeTopologyHash)
+    return false;
+
+  // set all capacities again on the cleared graph
+  m_MaxFlowGraph->reset();
+  for (typename GraphNodeContainer::ConstIterator graphNodesItr = graphNodes->Begin(); graphNodesItr!=graphNodes->End(); ++graphNodesItr)
+  {
+    const typename InputOSFGraphType::GraphNode& node = graphNodesItr.Value();
+    const std::size_t nodeId = graphNodesItr.Index();
+    m_MaxFlowGraph->add_st_edge( nodeId, node.cap_source, node.cap_sink );
+    m_SourceCapacities[nodeId] = node.cap_source;
+    m_SinkCapacities[nodeId] = node.cap_sink;
+  }
+  for (typename GraphEdgesContainer::ConstIterator graphEdgesItr = graphEdges->Begin(); graphEdgesItr!=graphEdges->End(); ++graphEdgesItr)
+  {
+    const typename InputOSFGraphType::GraphEdge& edge = graphEdgesItr.Value();
+    const std::size_t edgeId = graphEdgesItr.Index();
+    // edges were added in order, each add_edge() call adds a pair of directed edges
+    m_MaxFlowGraph->set_edge( 2*edgeId, edge.cap, edge.rev_cap );
+    m_EdgeCapacities[edgeId] = edge.cap;
+    m_EdgeReverseCapacities[edgeId] = edge.rev_cap;
+  }
+  m_Edges = graphEdges;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+std::size_t
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::HashEdge(std::size_t hash, std::size_t startNodeId, std::size_t endNodeId)
+{
+  // FNV-1a style combination, sufficient to recognize a different graph topology
+  const std::size_t prime = 1099511628211ULL;
+  hash = (hash ^ startNodeId) * prime;
+  hash = (hash ^ endNodeId) * prime;
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+bool
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::IsCapacityChangeSupported(CapacityType capacity, CapacityType previousCapacity)
+{
+  // a change from or to an infinite capacity cannot be applied as a difference
+  return capacity==previousCapacity || (!std::isinf(capacity) && !std::isinf(previousCapacity));
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+typename LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>::CapacityType
+LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
+::GetCapacityChange(CapacityType capacity, CapacityType previousCapacity)
+{
+  // an unchanged infinite capacity changes by 0, not by inf-inf, which is NaN
+  return (capacity==previousCapacity) ? CapacityType(0) : capacity-previousCapacity;
 }
 
 //----------------------------------------------------------------------------
@@ -99,7 +440,7 @@ void
 LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
 ::UpdateResult()
 {
-  // note: we assume Boykov's max flow lib procudes the same node_id's we use
+  // note: we assume the max flow engine produces the same node_id's we use
 
   // note: instead of iterating through all nodes, we could do a binary search on the nodes associated with a column
   // this could give some speedup in case of many column positions
@@ -142,6 +483,12 @@ LOGISMOSOSFGraphSolverFilter<TInputOSFGraph, TOutputOSFGraph>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "MaxFlowSolverEngine: " << m_MaxFlowSolverEngine << std::endl;
+  os << indent << "SmoothnessConstraint: " << m_SmoothnessConstraint << std::endl;
+  os << indent << "SoftSmoothnessPenalty: " << m_SoftSmoothnessPenalty << std::endl;
+  os << indent << "PackedEdgeStorage: " << m_PackedEdgeStorage << std::endl;
+  os << indent << "ReuseSearchTrees: " << m_ReuseSearchTrees << std::endl;
+  os << indent << "KeepMaxFlowGraph: " << m_KeepMaxFlowGraph << std::endl;
   // todo: implement
 }
 
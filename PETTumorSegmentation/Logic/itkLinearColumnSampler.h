@@ -0,0 +1,102 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+#ifndef _itkLinearColumnSampler_h
+#define _itkLinearColumnSampler_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkContinuousIndex.h"
+
+namespace itk
+{
+
+/** \class LinearColumnSampler
+ * \brief Samples an image with linear interpolation at all nodes of an OSF column.
+ *
+ * Replaces LinearInterpolateImageFunction::IsInsideBuffer() and Evaluate() per column node. The columns of the
+ * segmentation are straight rays (center + direction*step), so the first and last node are transformed into continuous
+ * index space once and the nodes in between are obtained by stepping along the ray. Columns whose nodes are not evenly
+ * spaced on a line are transformed node by node. The nodes are interpolated in blocks of NumberOfLanes, with the
+ * trilinear weights computed in loops over the lanes that the compiler can vectorize.
+ * Nodes inside the buffer get the value of LinearInterpolateImageFunction::Evaluate() (up to the rounding of the
+ * stepped indices), nodes outside keep their value.
+ * Template parameters for class LinearColumnSampler:
+ *
+ * - TInputImage = The three-dimensional image type to sample.
+ */
+template <class TInputImage>
+class ITK_EXPORT LinearColumnSampler : public Object
+{
+public:
+  using Self = LinearColumnSampler;
+  using Superclass = Object;
+  using Pointer = SmartPointer< Self >;
+  using ConstPointer = SmartPointer< const Self >;
+
+  ITK_DISALLOW_COPY_AND_ASSIGN(LinearColumnSampler);
+
+  itkNewMacro( Self );
+  itkTypeMacro( LinearColumnSampler, Object );
+
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+  static_assert( ImageDimension==3, "LinearColumnSampler only supports three-dimensional images." );
+
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using RealType = double;
+  using ContinuousIndexType = ContinuousIndex< RealType, ImageDimension >;
+
+  /** Number of column nodes interpolated together. */
+  static constexpr unsigned int NumberOfLanes = 8;
+
+  /** Sets the image to sample.  The buffer of the image must not change while it is sampled. */
+  void SetInputImage(const InputImageType* image);
+  itkGetConstObjectMacro( InputImage, InputImageType );
+
+  /** Samples the image at the points of a column.  Points outside of the buffer keep their value in values. */
+  template <typename TPoint, typename TOutput>
+  void SampleColumn(const TPoint* points, unsigned int numberOfPoints, TOutput* values) const;
+
+protected:
+  /** Constructor for use by New() method. */
+  LinearColumnSampler() = default;
+  ~LinearColumnSampler() override = default;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  /** Interpolates the image at the continuous indices of one block of lanes. */
+  template <typename TOutput>
+  void SampleLanes(const RealType (&index)[ImageDimension][NumberOfLanes], unsigned int numberOfLanes, TOutput* values) const;
+
+private:
+  typename InputImageType::ConstPointer m_InputImage;
+  const InputPixelType* m_Buffer{ nullptr };
+  OffsetValueType m_Strides[ImageDimension]{};
+  IndexValueType m_StartIndex[ImageDimension]{};
+  IndexValueType m_EndIndex[ImageDimension]{};
+  RealType m_StartContinuousIndex[ImageDimension]{};
+  RealType m_EndContinuousIndex[ImageDimension]{};
+
+}; // end class LinearColumnSampler
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLinearColumnSampler.txx"
+#endif
+
+#endif
@@ -0,0 +1,201 @@
+/*==============================================================================
+
+Program: PETTumorSegmentation
+
+(c) Copyright University of Iowa All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+
+#ifndef _itkLinearColumnSampler_txx
+#define _itkLinearColumnSampler_txx
+
+#include "itkLinearColumnSampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+void
+LinearColumnSampler<TInputImage>
+::SetInputImage(const InputImageType* image)
+{
+  m_InputImage = image;
+  m_Buffer = nullptr;
+  if (image==nullptr)
+    return;
+
+  // same bounds as ImageFunction::SetInputImage(): a point is inside if it is less than half a voxel beyond the centers
+  // of the outer voxels of the buffered region
+  const typename InputImageType::RegionType& region = image->GetBufferedRegion();
+  const OffsetValueType* offsetTable = image->GetOffsetTable();
+  for (unsigned int d=0; d<ImageDimension; d++)
+  {
+    m_Strides[d] = offsetTable[d];
+    m_StartIndex[d] = region.GetIndex()[d];
+    m_EndIndex[d] = region.GetIndex()[d] + static_cast<IndexValueType>(region.GetSize()[d]) - 1;
+    m_StartContinuousIndex[d] = static_cast<RealType>(m_StartIndex[d]) - 0.5;
+    m_EndContinuousIndex[d] = static_cast<RealType>(m_EndIndex[d]) + 0.5;
+  }
+  m_Buffer = image->GetBufferPointer();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+template <typename TPoint, typename TOutput>
+void
+LinearColumnSampler<TInputImage>
+::SampleColumn(const TPoint* points, unsigned int numberOfPoints, TOutput* values) const
+{
+  if (m_Buffer==nullptr || numberOfPoints==0)
+    return;
+
+  // a column is straight if its points are evenly spaced between the first and the last one; the tolerance only
+  // allows for the rounding of the coordinates
+  ContinuousIndexType firstIndex;
+  ContinuousIndexType step;
+  step.Fill(0.0);
+  m_InputImage->TransformPhysicalPointToContinuousIndex( points[0], firstIndex );
+  bool straight = true;
+  if (numberOfPoints>1)
+  {
+    const TPoint& first = points[0];
+    const TPoint& last = points[numberOfPoints-1];
+    const RealType tolerance = 1e-4 * first.EuclideanDistanceTo(last) / (numberOfPoints-1);
+    for (unsigned int i=1; i+1<numberOfPoints && straight; i++)
+    {
+      const RealType fraction = RealType(i) / RealType(numberOfPoints-1);
+      for (unsigned int d=0; d<ImageDimension; d++)
+        if (std::fabs( points[i][d] - (first[d] + (last[d]-first[d])*fraction) ) > tolerance)
+          straight = false;
+    }
+
+    ContinuousIndexType lastIndex;
+    m_InputImage->TransformPhysicalPointToContinuousIndex( last, lastIndex );
+    for (unsigned int d=0; d<ImageDimension; d++)
+      step[d] = (lastIndex[d]-firstIndex[d]) / RealType(numberOfPoints-1);
+  }
+
+  RealType index[ImageDimension][NumberOfLanes];
+  for (unsigned int start=0; start<numberOfPoints; start+=NumberOfLanes)
+  {
+    const unsigned int numberOfLanes = std::min( NumberOfLanes, numberOfPoints-start );
+    if (straight)
+    {
+      for (unsigned int d=0; d<ImageDimension; d++)
+        for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+          index[d][lane] = firstIndex[d] + step[d]*RealType(start+lane);
+    }
+    else
+    {
+      for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+      {
+        ContinuousIndexType pointIndex;
+        if (lane<numberOfLanes)
+          m_InputImage->TransformPhysicalPointToContinuousIndex( points[start+lane], pointIndex );
+        else // unused lanes of the last block
+          pointIndex = firstIndex;
+        for (unsigned int d=0; d<ImageDimension; d++)
+          index[d][lane] = pointIndex[d];
+      }
+    }
+    this->SampleLanes( index, numberOfLanes, values+start );
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+template <typename TOutput>
+void
+LinearColumnSampler<TInputImage>
+::SampleLanes(const RealType (&index)[ImageDimension][NumberOfLanes], unsigned int numberOfLanes, TOutput* values) const
+{
+  // bounds and weights as LinearInterpolateImageFunction: the lower neighbor is clamped to the start of the buffer with
+  // a weight of 0 for the upper neighbor, the upper neighbor is clamped to the end of the buffer
+  bool inside[NumberOfLanes];
+  for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+    inside[lane] = true;
+  for (unsigned int d=0; d<ImageDimension; d++)
+    for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+      inside[lane] = inside[lane] && index[d][lane]>=m_StartContinuousIndex[d] && index[d][lane]<m_EndContinuousIndex[d];
+
+  OffsetValueType lowerOffset[NumberOfLanes];
+  OffsetValueType upperStep[ImageDimension][NumberOfLanes];
+  RealType distance[ImageDimension][NumberOfLanes];
+  for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+    lowerOffset[lane] = 0;
+  for (unsigned int d=0; d<ImageDimension; d++)
+  {
+    for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+    {
+      const RealType x = inside[lane] ? index[d][lane] : RealType(m_StartIndex[d]);
+      const IndexValueType lower = std::max( static_cast<IndexValueType>(std::floor(x)), m_StartIndex[d] );
+      distance[d][lane] = std::max( x-static_cast<RealType>(lower), RealType(0) );
+      upperStep[d][lane] = lower<m_EndIndex[d] ? m_Strides[d] : 0;
+      lowerOffset[lane] += (lower-m_StartIndex[d])*m_Strides[d];
+    }
+  }
+
+  // gather the eight neighbors, then interpolate along x, y and z in the order of LinearInterpolateImageFunction;
+  // lanes outside of the buffer read the voxel at the start index, so all lanes can be interpolated
+  RealType neighbors[8][NumberOfLanes];
+  for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+  {
+    const InputPixelType* lower = m_Buffer + lowerOffset[lane];
+    const OffsetValueType x = upperStep[0][lane];
+    const OffsetValueType y = upperStep[1][lane];
+    const OffsetValueType z = upperStep[2][lane];
+    neighbors[0][lane] = static_cast<RealType>( lower[0] );
+    neighbors[1][lane] = static_cast<RealType>( lower[x] );
+    neighbors[2][lane] = static_cast<RealType>( lower[y] );
+    neighbors[3][lane] = static_cast<RealType>( lower[x+y] );
+    neighbors[4][lane] = static_cast<RealType>( lower[z] );
+    neighbors[5][lane] = static_cast<RealType>( lower[x+z] );
+    neighbors[6][lane] = static_cast<RealType>( lower[y+z] );
+    neighbors[7][lane] = static_cast<RealType>( lower[x+y+z] );
+  }
+
+  RealType interpolated[NumberOfLanes];
+  for (unsigned int lane=0; lane<NumberOfLanes; lane++)
+  {
+    const RealType valx00 = neighbors[0][lane] + (neighbors[1][lane]-neighbors[0][lane])*distance[0][lane];
+    const RealType valx10 = neighbors[2][lane] + (neighbors[3][lane]-neighbors[2][lane])*distance[0][lane];
+    const RealType valx01 = neighbors[4][lane] + (neighbors[5][lane]-neighbors[4][lane])*distance[0][lane];
+    const RealType valx11 = neighbors[6][lane] + (neighbors[7][lane]-neighbors[6][lane])*distance[0][lane];
+    const RealType valxx0 = valx00 + (valx10-valx00)*distance[1][lane];
+    const RealType valxx1 = valx01 + (valx11-valx01)*distance[1][lane];
+    interpolated[lane] = valxx0 + (valxx1-valxx0)*distance[2][lane];
+  }
+
+  for (unsigned int lane=0; lane<numberOfLanes; lane++)
+    if (inside[lane])
+      values[lane] = static_cast<TOutput>( interpolated[lane] );
+}
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+void
+LinearColumnSampler<TInputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "InputImage: " << m_InputImage.GetPointer() << std::endl;
+}
+
+} // namespace
+
+#endif
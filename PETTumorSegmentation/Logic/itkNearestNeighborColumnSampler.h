@@ -0,0 +1,104 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+#ifndef _itkNearestNeighborColumnSampler_h
+#define _itkNearestNeighborColumnSampler_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkContinuousIndex.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class NearestNeighborColumnSampler
+ * \brief Samples a label image with nearest neighbor interpolation along an OSF column as runs of equal labels.
+ *
+ * Replaces NearestNeighborInterpolateImageFunction::IsInsideBuffer() and Evaluate() per column node for label images,
+ * where the cost functions only need the positions at which the label along the column changes. Like
+ * LinearColumnSampler, straight columns are stepped in continuous index space from the first to the last node, other
+ * columns are transformed node by node. The image is only read when the nearest voxel changes, and consecutive nodes
+ * with the same label are merged into one run. Nodes outside of the buffer have the label 0. The runs cover all nodes
+ * of the column in order.
+ * Template parameters for class NearestNeighborColumnSampler:
+ *
+ * - TInputImage = The three-dimensional label image type to sample.
+ */
+template <class TInputImage>
+class ITK_EXPORT NearestNeighborColumnSampler : public Object
+{
+public:
+  using Self = NearestNeighborColumnSampler;
+  using Superclass = Object;
+  using Pointer = SmartPointer< Self >;
+  using ConstPointer = SmartPointer< const Self >;
+
+  ITK_DISALLOW_COPY_AND_ASSIGN(NearestNeighborColumnSampler);
+
+  itkNewMacro( Self );
+  itkTypeMacro( NearestNeighborColumnSampler, Object );
+
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+  static_assert( ImageDimension==3, "NearestNeighborColumnSampler only supports three-dimensional images." );
+
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using RealType = double;
+  using ContinuousIndexType = ContinuousIndex< RealType, ImageDimension >;
+
+  /** Consecutive column nodes First to Last (inclusive) with the same label. */
+  struct RunType
+  {
+    InputPixelType Label;
+    unsigned int First;
+    unsigned int Last;
+  };
+  using RunsContainer = std::vector< RunType >;
+
+  /** Sets the image to sample.  The buffer of the image must not change while it is sampled. */
+  void SetInputImage(const InputImageType* image);
+  itkGetConstObjectMacro( InputImage, InputImageType );
+
+  /** Samples the image at the points of a column and replaces runs by the label runs along the column. */
+  template <typename TPoint>
+  void SampleColumnRuns(const TPoint* points, unsigned int numberOfPoints, RunsContainer& runs) const;
+
+protected:
+  /** Constructor for use by New() method. */
+  NearestNeighborColumnSampler() = default;
+  ~NearestNeighborColumnSampler() override = default;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  typename InputImageType::ConstPointer m_InputImage;
+  const InputPixelType* m_Buffer{ nullptr };
+  OffsetValueType m_Strides[ImageDimension]{};
+  IndexValueType m_StartIndex[ImageDimension]{};
+  RealType m_StartContinuousIndex[ImageDimension]{};
+  RealType m_EndContinuousIndex[ImageDimension]{};
+
+}; // end class NearestNeighborColumnSampler
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkNearestNeighborColumnSampler.txx"
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+/*==============================================================================
+
+Program: PETTumorSegmentation
+
+(c) Copyright University of Iowa All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+
+#ifndef _itkNearestNeighborColumnSampler_txx
+#define _itkNearestNeighborColumnSampler_txx
+
+#include "itkNearestNeighborColumnSampler.h"
+#include "itkMath.h"
+
+#include <cmath>
+
+namespace itk
+{
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+void
+NearestNeighborColumnSampler<TInputImage>
+::SetInputImage(const InputImageType* image)
+{
+  m_InputImage = image;
+  m_Buffer = nullptr;
+  if (image==nullptr)
+    return;
+
+  // same bounds as ImageFunction::SetInputImage()
+  const typename InputImageType::RegionType& region = image->GetBufferedRegion();
+  const OffsetValueType* offsetTable = image->GetOffsetTable();
+  for (unsigned int d=0; d<ImageDimension; d++)
+  {
+    m_Strides[d] = offsetTable[d];
+    m_StartIndex[d] = region.GetIndex()[d];
+    m_StartContinuousIndex[d] = static_cast<RealType>(m_StartIndex[d]) - 0.5;
+    m_EndContinuousIndex[d] = static_cast<RealType>(m_StartIndex[d] + static_cast<IndexValueType>(region.GetSize()[d])) - 0.5;
+  }
+  m_Buffer = image->GetBufferPointer();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+template <typename TPoint>
+void
+NearestNeighborColumnSampler<TInputImage>
+::SampleColumnRuns(const TPoint* points, unsigned int numberOfPoints, RunsContainer& runs) const
+{
+  runs.clear();
+  if (numberOfPoints==0)
+    return;
+  if (m_Buffer==nullptr)
+  {
+    runs.push_back( RunType{ InputPixelType(0), 0, numberOfPoints-1 } );
+    return;
+  }
+
+  // a column is straight if its points are evenly spaced between the first and the last one
+  ContinuousIndexType firstIndex;
+  ContinuousIndexType step;
+  step.Fill(0.0);
+  m_InputImage->TransformPhysicalPointToContinuousIndex( points[0], firstIndex );
+  bool straight = true;
+  if (numberOfPoints>1)
+  {
+    const TPoint& first = points[0];
+    const TPoint& last = points[numberOfPoints-1];
+    const RealType tolerance = 1e-4 * first.EuclideanDistanceTo(last) / (numberOfPoints-1);
+    for (unsigned int i=1; i+1<numberOfPoints && straight; i++)
+    {
+      const RealType fraction = RealType(i) / RealType(numberOfPoints-1);
+      for (unsigned int d=0; d<ImageDimension; d++)
+        if (std::fabs( points[i][d] - (first[d] + (last[d]-first[d])*fraction) ) > tolerance)
+          straight = false;
+    }
+
+    ContinuousIndexType lastIndex;
+    m_InputImage->TransformPhysicalPointToContinuousIndex( last, lastIndex );
+    for (unsigned int d=0; d<ImageDimension; d++)
+      step[d] = (lastIndex[d]-firstIndex[d]) / RealType(numberOfPoints-1);
+  }
+
+  // the label is only read when the nearest voxel changes; with columns spaced finer than the voxels, several
+  // consecutive nodes share a voxel
+  OffsetValueType previousOffset = -1;
+  InputPixelType label = InputPixelType(0);
+  for (unsigned int i=0; i<numberOfPoints; i++)
+  {
+    ContinuousIndexType index;
+    if (straight)
+    {
+      for (unsigned int d=0; d<ImageDimension; d++)
+        index[d] = firstIndex[d] + step[d]*RealType(i);
+    }
+    else
+      m_InputImage->TransformPhysicalPointToContinuousIndex( points[i], index );
+
+    bool inside = true;
+    OffsetValueType offset = 0;
+    for (unsigned int d=0; d<ImageDimension; d++)
+    {
+      inside = inside && index[d]>=m_StartContinuousIndex[d] && index[d]<m_EndContinuousIndex[d];
+      if (inside)
+        offset += (Math::RoundHalfIntegerUp<IndexValueType>(index[d])-m_StartIndex[d])*m_Strides[d];
+    }
+    if (!inside)
+      offset = -1;
+    if (offset!=previousOffset)
+    {
+      label = inside ? m_Buffer[offset] : InputPixelType(0);
+      previousOffset = offset;
+    }
+
+    if (!runs.empty() && runs.back().Label==label)
+      runs.back().Last = i;
+    else
+      runs.push_back( RunType{ label, i, i } );
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class TInputImage>
+void
+NearestNeighborColumnSampler<TInputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "InputImage: " << m_InputImage.GetPointer() << std::endl;
+}
+
+} // namespace
+
+#endif
@@ -122,7 +122,13 @@ public:
   
   // utility function for fast lookup of graph nodes/edges associated with a SurfaceVertexColumnPosition
   // after graph construction (nodes/edges) the internally used lookup table has to be build first
+  // the nodes of a column need consecutive identifiers, the lookup is only checked in debug builds
   void BuildGraphNodeIdentifierLookupTable();
+  // copy the lookup table of a graph with the same nodes instead of building it
+  void CopyGraphNodeIdentifierLookupTable(const Self* graph);
+  // copy-on-write copy of the nodes, edges and lookup table of a graph: the node and edge containers are shared
+  // until one of the graphs accesses them through a non-const method
+  void ShareNodesAndEdges(const Self* graph);
   GraphNodeIdentifier GetNodeIdentifer(SurfaceIdentifier surfaceId, VertexIdentifier vertexId, ColumnPositionIdentifier columnPositionId) const;
   GraphNode& GetNode(SurfaceIdentifier surfaceId, VertexIdentifier vertexId, ColumnPositionIdentifier columnPositionId);
   const GraphNode& GetNode(SurfaceIdentifier surfaceId, VertexIdentifier vertexId, ColumnPositionIdentifier columnPositionId) const;
@@ -167,8 +173,12 @@ protected:
   typename SurfacesContainer::Pointer m_SurfacesContainer{ SurfacesContainer::New() };
   typename GraphNodesContainer::Pointer m_GraphNodesContainer{ GraphNodesContainer::New() };
   typename GraphEdgesContainer::Pointer m_GraphEdgesContainer{ GraphEdgesContainer::New() };
+  mutable bool m_GraphNodesShared{ false }; // nodes may be shared with another graph, see ShareNodesAndEdges()
+  mutable bool m_GraphEdgesShared{ false };
+  void DetachNodes();
+  void DetachEdges();
   
-  std::vector< std::vector< std::vector< GraphNodeIdentifier > > > m_GraphNodeIdentifierLookupTable; // todo: probably not optimal data structure but should be sufficient
+  std::vector< std::vector< GraphNodeIdentifier > > m_GraphNodeIdentifierLookupTable; // identifier of the node at position 0 for each vertex of each surface
   
   // If the RegionType is ITK_UNSTRUCTURED_REGION, then the following
   // variables represent the maximum number of region that the data
@@ -87,6 +87,7 @@ typename OSFGraph<TCostType, TSurfaceMeshTraits >::GraphNode&
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::GetNode(GraphNodeIdentifier nodeId)
 {
+  this->DetachNodes();
   if ( !m_GraphNodesContainer->IndexExists(nodeId) )
     {
       m_GraphNodesContainer->InsertElement( nodeId, GraphNode() ); // create container if it does not exists yet
@@ -113,6 +114,7 @@ void
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::SetNode(GraphNodeIdentifier nodeId, const GraphNode& node)
 {
+  this->DetachNodes();
   if ( !m_GraphNodesContainer->IndexExists(nodeId) )
   {
     m_GraphNodesContainer->InsertElement( nodeId, node );
@@ -131,6 +133,7 @@ typename OSFGraph<TCostType, TSurfaceMeshTraits >::GraphNodesContainer*
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::GetNodes()
 {
+  this->DetachNodes();
   return m_GraphNodesContainer;
 }
 
@@ -152,6 +155,7 @@ OSFGraph<TCostType, TSurfaceMeshTraits >
   if (m_GraphNodesContainer!=nodes)
   {
     m_GraphNodesContainer = nodes;
+    m_GraphNodesShared = false;
     this->Modified();
   }
 }
@@ -171,6 +175,7 @@ typename OSFGraph<TCostType, TSurfaceMeshTraits >::GraphEdge&
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::GetEdge(GraphEdgeIdentifier edgeId)
 {
+  this->DetachEdges();
   if ( !m_GraphEdgesContainer->IndexExists(edgeId) )
     {
       m_GraphEdgesContainer->InsertElement( edgeId, GraphEdge() ); // create container if it does not exists yet
@@ -197,6 +202,7 @@ void
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::SetEdge(GraphEdgeIdentifier edgeId, const GraphEdge& edge)
 {
+  this->DetachEdges();
   if ( !m_GraphEdgesContainer->IndexExists(edgeId) )
   {
     m_GraphEdgesContainer->InsertElement( edgeId, edge );
@@ -215,6 +221,7 @@ typename OSFGraph<TCostType, TSurfaceMeshTraits >::GraphEdgesContainer*
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::GetEdges()
 {
+  this->DetachEdges();
   return m_GraphEdgesContainer;
 }
 
@@ -236,52 +243,102 @@ OSFGraph<TCostType, TSurfaceMeshTraits >
   if (m_GraphEdgesContainer!=edges)
   {
     m_GraphEdgesContainer = edges;
+    m_GraphEdgesShared = false;
     this->Modified();
   }
 }
 
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFGraph<TCostType, TSurfaceMeshTraits >
+::ShareNodesAndEdges(const Self* graph)
+{
+  if (graph==this)
+    return;
+  m_GraphNodesContainer = graph->m_GraphNodesContainer;
+  m_GraphEdgesContainer = graph->m_GraphEdgesContainer;
+  m_GraphNodesShared = m_GraphEdgesShared = true;
+  graph->m_GraphNodesShared = graph->m_GraphEdgesShared = true;
+  m_GraphNodeIdentifierLookupTable = graph->m_GraphNodeIdentifierLookupTable;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFGraph<TCostType, TSurfaceMeshTraits >
+::DetachNodes()
+{
+  if (!m_GraphNodesShared)
+    return;
+  if (m_GraphNodesContainer->GetReferenceCount()>1)
+  {
+    typename GraphNodesContainer::Pointer nodes = GraphNodesContainer::New();
+    nodes->CastToSTLContainer() = m_GraphNodesContainer->CastToSTLConstContainer();
+    m_GraphNodesContainer = nodes;
+  }
+  m_GraphNodesShared = false;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFGraph<TCostType, TSurfaceMeshTraits >
+::DetachEdges()
+{
+  if (!m_GraphEdgesShared)
+    return;
+  if (m_GraphEdgesContainer->GetReferenceCount()>1)
+  {
+    typename GraphEdgesContainer::Pointer edges = GraphEdgesContainer::New();
+    edges->CastToSTLContainer() = m_GraphEdgesContainer->CastToSTLConstContainer();
+    m_GraphEdgesContainer = edges;
+  }
+  m_GraphEdgesShared = false;
+}
+
 //----------------------------------------------------------------------------
 template <typename TCostType, typename TSurfaceMeshTraits >
 void
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::BuildGraphNodeIdentifierLookupTable()
 {
-  // note: because of the type of the datastrucure for the lookup table and it's construction a lot of copying and reallocation may occur.
-  // -> reimplement the lookup table if really slow in practice
+  // nodes of a column have consecutive identifiers in the order of their positions (see SimpleOSFGraphBuilderFilter),
+  // so only the identifier of the node at position 0 of each column is stored
+  m_GraphNodeIdentifierLookupTable.resize( this->GetNumberOfSurfaces() );
+  for (SurfaceIdentifier surfaceId=0; surfaceId<this->GetNumberOfSurfaces(); surfaceId++)
+    m_GraphNodeIdentifierLookupTable[surfaceId].assign( this->GetSurface(surfaceId)->GetNumberOfVertices(), 0 );
 
   for (typename GraphNodesContainer::ConstIterator nodeIt=m_GraphNodesContainer->Begin(); nodeIt!=m_GraphNodesContainer->End(); nodeIt++)
   {
-    GraphNodeIdentifier nodeId = nodeIt.Index();
     const GraphNode& node = nodeIt.Value();
-    SurfaceIdentifier surfaceId = node.surfaceId;
-    VertexIdentifier vertexId = node.vertexId;
-    ColumnPositionIdentifier positionId = node.positionId;
-
-    //std::cout << nodeId << " " << surfaceId << " " << vertexId <<  " " << positionId << std::endl;
-
-    if (m_GraphNodeIdentifierLookupTable.size()<surfaceId+1)
-      m_GraphNodeIdentifierLookupTable.resize(surfaceId+1);
-    if (m_GraphNodeIdentifierLookupTable[surfaceId].size()<vertexId+1)
-      m_GraphNodeIdentifierLookupTable[surfaceId].resize(vertexId+1);
-    if (m_GraphNodeIdentifierLookupTable[surfaceId][vertexId].size()<positionId+1)
-      m_GraphNodeIdentifierLookupTable[surfaceId][vertexId].resize(positionId+1);
-    m_GraphNodeIdentifierLookupTable[surfaceId][vertexId][positionId] = nodeId;
+    if (node.surfaceId<m_GraphNodeIdentifierLookupTable.size() && node.vertexId<m_GraphNodeIdentifierLookupTable[node.surfaceId].size())
+      m_GraphNodeIdentifierLookupTable[node.surfaceId][node.vertexId] = nodeIt.Index()-node.positionId;
   }
 }
 
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFGraph<TCostType, TSurfaceMeshTraits >
+::CopyGraphNodeIdentifierLookupTable(const Self* graph)
+{
+  m_GraphNodeIdentifierLookupTable = graph->m_GraphNodeIdentifierLookupTable;
+}
+
 //----------------------------------------------------------------------------
 template <typename TCostType, typename TSurfaceMeshTraits >
 typename OSFGraph<TCostType, TSurfaceMeshTraits >::GraphNodeIdentifier
 OSFGraph<TCostType, TSurfaceMeshTraits >
 ::GetNodeIdentifer(SurfaceIdentifier surfaceId, VertexIdentifier vertexId, ColumnPositionIdentifier columnPositionId) const
 {
-  if (surfaceId+1>m_GraphNodeIdentifierLookupTable.size())
-    return 0;
-  if (vertexId+1>m_GraphNodeIdentifierLookupTable[surfaceId].size())
-    return 0;
-  if (columnPositionId+1>m_GraphNodeIdentifierLookupTable[surfaceId][vertexId].size())
-    return 0;
-  return m_GraphNodeIdentifierLookupTable[surfaceId][vertexId][columnPositionId];
+  itkAssertInDebugAndIgnoreInReleaseMacro( surfaceId<m_GraphNodeIdentifierLookupTable.size() );
+  itkAssertInDebugAndIgnoreInReleaseMacro( vertexId<m_GraphNodeIdentifierLookupTable[surfaceId].size() );
+  GraphNodeIdentifier nodeId = m_GraphNodeIdentifierLookupTable[surfaceId][vertexId]+columnPositionId;
+  itkAssertInDebugAndIgnoreInReleaseMacro( nodeId<this->GetNumberOfNodes() && this->GetNode(nodeId).surfaceId==surfaceId
+    && this->GetNode(nodeId).vertexId==vertexId && this->GetNode(nodeId).positionId==columnPositionId );
+  return nodeId;
 }
 
 //----------------------------------------------------------------------------
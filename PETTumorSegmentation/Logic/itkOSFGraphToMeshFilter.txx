@@ -134,7 +134,7 @@ OSFGraphToMeshFilter<TInputOSFGraph,TOutputMesh>
       case OutermostSurface: columnPositionId = (osfSurface->GetNumberOfColumns(vertexId)>0) ? osfSurface->GetNumberOfColumns(vertexId) : 0; break;
       default: columnPositionId = osfSurface->GetCurrentVertexPositionIdentifier(vertexId);
     }
-    pointIterator.Value() = osfSurface->GetColumnCoordinates(vertexId)->ElementAt(columnPositionId);
+    pointIterator.Value() = osfSurface->GetColumnCoordinatesSpan(vertexId)[columnPositionId];
     ++pointIterator;
   }
   
@@ -90,26 +90,30 @@ void
 OSFGraphToOSFGraphFilter<TInputOSFGraph, TOutputOSFGraph>
 ::CopyInputOSFGraphToOutputOSFGraphSurface(OSFSurfaceConstPointer inputOSFSurface, OSFSurfacePointer outputOSFSurface)
 {  
+  // contiguous columns, cells and neighborhood are shared, columns are copied when written
+  if (inputOSFSurface->GetColumnsPacked())
+  {
+    outputOSFSurface->ShareSurface( inputOSFSurface );
+    return;
+  }
+
   // copy vertex information
   typename OSFSurface::VertexIdentifier numVertices = inputOSFSurface->GetNumberOfVertices();
   for (typename OSFSurface::VertexIdentifier vertexId=0; vertexId<numVertices; vertexId++)
   {
     // copy column point coordinates
     {
-      using InputColumnCoordinatesContainerType = typename InputOSFGraphType::OSFSurface::ColumnCoordinatesContainer;
-      typename InputColumnCoordinatesContainerType::ConstPointer inputPoints = inputOSFSurface->GetColumnCoordinates( vertexId );
-      if (inputPoints)
+      typename InputOSFGraphType::OSFSurface::ConstColumnCoordinatesSpan inputPoints = inputOSFSurface->GetColumnCoordinatesSpan( vertexId );
+      if (inputPoints.size()>0)
       {
-        typename InputColumnCoordinatesContainerType::ConstIterator inputItr = inputPoints->Begin();
-        typename InputColumnCoordinatesContainerType::ConstIterator inputEnd = inputPoints->End();
         using OutputColumnCoordinatesContainerType = typename OutputOSFGraphType::OSFSurface::ColumnCoordinatesContainer;
         typename OutputColumnCoordinatesContainerType::Pointer outputPoints = OutputColumnCoordinatesContainerType::New();
-        outputPoints->Reserve( inputPoints->Size() );
+        outputPoints->Reserve( inputPoints.size() );
         typename OutputColumnCoordinatesContainerType::Iterator outputItr = outputPoints->Begin();
-        while (inputItr!=inputEnd)
+        for (const auto& inputPoint : inputPoints)
         {
-          outputItr.Value() = inputItr.Value();
-          ++inputItr; ++outputItr;
+          outputItr.Value() = inputPoint;
+          ++outputItr;
         }
         outputOSFSurface->SetColumnCoordinates( vertexId, outputPoints );
       }
@@ -117,20 +121,17 @@ OSFGraphToOSFGraphFilter<TInputOSFGraph, TOutputOSFGraph>
     
     // copy column point costs
     {
-      using InputColumnCostsContainerType = typename InputOSFGraphType::OSFSurface::ColumnCostsContainer;
-      typename InputColumnCostsContainerType::ConstPointer inputCosts = inputOSFSurface->GetColumnCosts( vertexId );
-      if (inputCosts)
+      typename InputOSFGraphType::OSFSurface::ConstColumnCostsSpan inputCosts = inputOSFSurface->GetColumnCostsSpan( vertexId );
+      if (inputCosts.size()>0)
       {
-        typename InputColumnCostsContainerType::ConstIterator inputItr = inputCosts->Begin();
-        typename InputColumnCostsContainerType::ConstIterator inputEnd = inputCosts->End();
         using OutputColumnCostsContainerType = typename OutputOSFGraphType::OSFSurface::ColumnCostsContainer;
         typename OutputColumnCostsContainerType::Pointer outputCosts = OutputColumnCostsContainerType::New();
-        outputCosts->Reserve( inputCosts->Size() );
+        outputCosts->Reserve( inputCosts.size() );
         typename OutputColumnCostsContainerType::Iterator outputItr = outputCosts->Begin();
-        while (inputItr!=inputEnd)
+        for (const auto& inputCost : inputCosts)
         {
-          outputItr.Value() = inputItr.Value();
-          ++inputItr; ++outputItr;
+          outputItr.Value() = inputCost;
+          ++outputItr;
         }
         outputOSFSurface->SetColumnCosts( vertexId, outputCosts );
       }
@@ -21,6 +21,10 @@
 #include <itkDataObject.h>
 #include <itkObject.h>
 #include <itkMesh.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace itk
 {
@@ -84,14 +88,64 @@ public:
   
   // access to column coordinates of a vertex
   ColumnCoordinatesContainer* GetColumnCoordinates(VertexIdentifier vertexId);
-  const ColumnCoordinatesContainer* GetColumnCoordinates(VertexIdentifier vertexId) const;
   void SetColumnCoordinates(VertexIdentifier vertexId, ColumnCoordinatesContainer* columnCoordinates);
   
   // access to column costs of a vertex
   ColumnCostsContainer* GetColumnCosts(VertexIdentifier vertexId);
-  const ColumnCostsContainer* GetColumnCosts(VertexIdentifier vertexId) const;
   void SetColumnCosts(VertexIdentifier vertexId, ColumnCostsContainer* columnCosts);
   
+  // optional contiguous (structure of arrays) storage of the columns of all vertices: one coordinate and one cost
+  // buffer indexed by the offsets of the columns. The spans work for both storages. While the columns are packed,
+  // the per-vertex container accessors unpack the columns first, so they are only available on non-const surfaces.
+  // Packed buffers can be shared between surfaces (see ShareSurface()) and are copied by the first writable span
+  // of a surface; this is safe for concurrent writers, but not for readers of the buffer being written.
+  template <typename TElement>
+  class ColumnSpan
+  {
+  public:
+    ColumnSpan() = default;
+    ColumnSpan(TElement* data, ColumnPositionIdentifier size) : m_Data(data), m_Size(size) {}
+    TElement* begin() const { return m_Data; }
+    TElement* end() const { return m_Data+m_Size; }
+    TElement& operator[](ColumnPositionIdentifier columnPositionId) const { return m_Data[columnPositionId]; }
+    ColumnPositionIdentifier size() const { return m_Size; }
+  private:
+    TElement* m_Data{ nullptr };
+    ColumnPositionIdentifier m_Size{ 0 };
+  };
+  using ColumnCoordinatesSpan = ColumnSpan< CoordinateType >;
+  using ConstColumnCoordinatesSpan = ColumnSpan< const CoordinateType >;
+  using ColumnCostsSpan = ColumnSpan< ColumnCostType >;
+  using ConstColumnCostsSpan = ColumnSpan< const ColumnCostType >;
+  ConstColumnCoordinatesSpan GetColumnCoordinatesSpan(VertexIdentifier vertexId) const;
+  ColumnCoordinatesSpan GetWritableColumnCoordinatesSpan(VertexIdentifier vertexId);
+  ConstColumnCostsSpan GetColumnCostsSpan(VertexIdentifier vertexId) const;
+  ColumnCostsSpan GetWritableColumnCostsSpan(VertexIdentifier vertexId);
+
+  using PackedColumnOffsetsContainer = std::vector< ColumnPositionIdentifier >;
+  using PackedColumnCoordinatesContainer = std::vector< CoordinateType >;
+  using PackedColumnCostsContainer = std::vector< ColumnCostType >;
+  bool PackColumns(); // fails if the costs and coordinates of a column differ in size
+  void UnpackColumns();
+  bool GetColumnsPacked() const;
+  const PackedColumnOffsetsContainer& GetPackedColumnOffsets() const;
+  const PackedColumnCoordinatesContainer& GetPackedColumnCoordinates() const;
+  const PackedColumnCostsContainer& GetPackedColumnCosts() const;
+  PackedColumnCostsContainer& GetWritablePackedColumnCosts(); // copies a shared buffer like the writable spans; do not resize
+  void SetPackedColumns(const PackedColumnOffsetsContainer& offsets, const PackedColumnCoordinatesContainer& coordinates, const PackedColumnCostsContainer& costs);
+
+  // copy-on-write copy of a surface with packed columns: the column buffers are shared until written, the cells
+  // and the neighbor lookup table are shared and must not be modified, the position identifiers are copied
+  void ShareSurface(const Self* surface);
+
+  // columns whose costs may have been written since ClearDirtyColumns(): the writable cost spans and containers mark
+  // their column, the writable packed costs and SetPackedColumns() mark all columns, ShareSurface() copies the marks.
+  // A graph builder can then update only the nodes of the dirty columns (see SimpleOSFGraphBuilderFilter).
+  void ClearDirtyColumns();
+  bool GetDirtyColumnsTracked() const; // false before ClearDirtyColumns() and after all columns were marked
+  bool GetColumnCostsDirty(VertexIdentifier vertexId) const; // true for all columns if the marks are not tracked
+  void MarkAllColumnsDirty();
+
   // access to initial vertex position
   const CoordinateType& GetInitialVertexPosition(VertexIdentifier vertexId) const;
   ColumnPositionIdentifier GetInitialVertexPositionIdentifier(VertexIdentifier vertexId) const;
@@ -116,6 +170,9 @@ public:
   using VertexIdentifierContainer = VectorContainer< unsigned int, VertexIdentifier >;
   const VertexIdentifierContainer* GetNeighbors(VertexIdentifier vertexId) const;
   void BuildNeighborLookupTable();
+  bool HasNeighborLookupTable() const;
+  // share the (read-only) lookup table of a surface with identical vertices and cells instead of building it
+  void CopyNeighborLookupTable(const Self* surface);
 
   // todo: do we need cell links like provided by the itk::Mesh?
   //using PointCellLinksContainer = typename MeshTraits::PointCellLinksContainer; // todo: do we need this?
@@ -133,6 +190,20 @@ protected:
   VertexPositionIdentifierContainer::Pointer m_VertexCurrentPositionIdentifierContainer{ VertexPositionIdentifierContainer::New() };
   typename CellsContainer::Pointer m_CellsContainer{ CellsContainer::New() };
   
+  PackedColumnOffsetsContainer m_PackedColumnOffsets; // number of vertices+1 offsets into the packed buffers, empty if not packed
+  std::shared_ptr< PackedColumnCoordinatesContainer > m_PackedColumnCoordinates{ std::make_shared< PackedColumnCoordinatesContainer >() };
+  std::shared_ptr< PackedColumnCostsContainer > m_PackedColumnCosts{ std::make_shared< PackedColumnCostsContainer >() };
+  mutable std::atomic<bool> m_PackedColumnCoordinatesShared{ false }; // buffer may be shared with another surface
+  mutable std::atomic<bool> m_PackedColumnCostsShared{ false };
+  std::mutex m_PackedColumnsMutex;
+
+  std::vector< unsigned char > m_DirtyColumns; // one byte per vertex, so concurrent writers of different columns do not conflict
+  std::atomic<bool> m_DirtyColumnsTracked{ false };
+  void MarkColumnDirty(VertexIdentifier vertexId);
+
+  template <typename TContainer>
+  void DetachPackedColumns(std::shared_ptr< TContainer >& buffer, std::atomic<bool>& shared);
+  
   void ReleaseCellsMemory();
   
   using VertexIdentifierListContainer = VectorContainer< VertexIdentifier, typename VertexIdentifierContainer::Pointer >;
@@ -19,6 +19,7 @@ limitations under the License.
 #define _itkOSFSurface_txx
 
 #include "itkOSFSurface.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -29,6 +30,8 @@ typename OSFSurface<TCostType, TSurfaceMeshTraits>::VertexIdentifier
 OSFSurface<TCostType, TSurfaceMeshTraits>
 ::GetNumberOfVertices() const
 {
+  if ( this->GetColumnsPacked() )
+    return m_PackedColumnOffsets.size()-1;
   return  m_VertexColumnCoordinatesContainer->Size();
 }
 
@@ -38,6 +41,8 @@ typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnCoordinatesContainer*
 OSFSurface<TCostType, TSurfaceMeshTraits>
 ::GetColumnCoordinates(VertexIdentifier vertexId)
 {
+  if ( this->GetColumnsPacked() )
+    this->UnpackColumns();
   if ( !m_VertexColumnCoordinatesContainer->IndexExists(vertexId) || !m_VertexColumnCoordinatesContainer->GetElement(vertexId) )
     {
       m_VertexColumnCoordinatesContainer->InsertElement( vertexId, ColumnCoordinatesContainer::New() );
@@ -45,21 +50,14 @@ OSFSurface<TCostType, TSurfaceMeshTraits>
   return m_VertexColumnCoordinatesContainer->GetElement( vertexId );
 }
   
-//----------------------------------------------------------------------------
-template <typename TCostType, typename TSurfaceMeshTraits >
-const typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnCoordinatesContainer*
-OSFSurface<TCostType, TSurfaceMeshTraits>
-::GetColumnCoordinates(VertexIdentifier vertexId) const
-{
-  return m_VertexColumnCoordinatesContainer->GetElement( vertexId ).GetPointer();
-}
-
 //----------------------------------------------------------------------------
 template <typename TCostType, typename TSurfaceMeshTraits >
 void
 OSFSurface<TCostType, TSurfaceMeshTraits>
 ::SetColumnCoordinates(VertexIdentifier vertexId, ColumnCoordinatesContainer* columnCoordinates)
 {
+  if ( this->GetColumnsPacked() )
+    this->UnpackColumns();
   if ( !m_VertexColumnCoordinatesContainer->IndexExists(vertexId) )
   {
     m_VertexColumnCoordinatesContainer->InsertElement( vertexId, columnCoordinates );
@@ -78,6 +76,8 @@ typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnPositionIdentifier
 OSFSurface<TCostType, TSurfaceMeshTraits>
 ::GetNumberOfColumns(VertexIdentifier vertexId) const
 {
+  if ( this->GetColumnsPacked() )
+    return vertexId+1<m_PackedColumnOffsets.size() ? m_PackedColumnOffsets[vertexId+1]-m_PackedColumnOffsets[vertexId] : 0;
   typename ColumnCoordinatesContainer::Pointer columnCoordinatesContainer;
   if ( m_VertexColumnCoordinatesContainer->GetElementIfIndexExists(vertexId,&columnCoordinatesContainer) )
     if ( columnCoordinatesContainer )
@@ -92,28 +92,25 @@ typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnCostsContainer*
 OSFSurface<TCostType, TSurfaceMeshTraits>
 ::GetColumnCosts(VertexIdentifier vertexId)
 {
+  if ( this->GetColumnsPacked() )
+    this->UnpackColumns();
   if ( !m_VertexColumnCostsContainer->IndexExists(vertexId) || !m_VertexColumnCostsContainer->GetElement(vertexId) )
     {
       m_VertexColumnCostsContainer->InsertElement( vertexId, ColumnCostsContainer::New() ); // create container if it does not exists yet
     }
+  this->MarkColumnDirty( vertexId );
   return m_VertexColumnCostsContainer->GetElement( vertexId );
 }
 
-//----------------------------------------------------------------------------
-template <typename TCostType, typename TSurfaceMeshTraits >
-const typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnCostsContainer*
-OSFSurface<TCostType, TSurfaceMeshTraits>
-::GetColumnCosts(VertexIdentifier vertexId) const
-{
-  return m_VertexColumnCostsContainer->GetElement( vertexId ).GetPointer();
-}
-
 //----------------------------------------------------------------------------
 template <typename TCostType, typename TSurfaceMeshTraits >
 void
 OSFSurface<TCostType, TSurfaceMeshTraits>
 ::SetColumnCosts(VertexIdentifier vertexId, ColumnCostsContainer* columnCosts)
 {
+  if ( this->GetColumnsPacked() )
+    this->UnpackColumns();
+  this->MarkColumnDirty( vertexId );
   if ( !m_VertexColumnCostsContainer->IndexExists(vertexId) )
   {
     m_VertexColumnCostsContainer->InsertElement( vertexId, columnCosts ); // create container if it does not exists yet
@@ -126,6 +123,301 @@ OSFSurface<TCostType, TSurfaceMeshTraits>
   }
 }
 
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+typename OSFSurface<TCostType, TSurfaceMeshTraits>::ConstColumnCoordinatesSpan
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetColumnCoordinatesSpan(VertexIdentifier vertexId) const
+{
+  if ( this->GetColumnsPacked() )
+    return ConstColumnCoordinatesSpan( m_PackedColumnCoordinates->data()+m_PackedColumnOffsets[vertexId], this->GetNumberOfColumns(vertexId) );
+  typename ColumnCoordinatesContainer::Pointer columnCoordinates;
+  if ( !m_VertexColumnCoordinatesContainer->GetElementIfIndexExists(vertexId,&columnCoordinates) || !columnCoordinates )
+    return ConstColumnCoordinatesSpan();
+  return ConstColumnCoordinatesSpan( columnCoordinates->CastToSTLConstContainer().data(), columnCoordinates->Size() );
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnCoordinatesSpan
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetWritableColumnCoordinatesSpan(VertexIdentifier vertexId)
+{
+  if ( this->GetColumnsPacked() )
+  {
+    this->DetachPackedColumns( m_PackedColumnCoordinates, m_PackedColumnCoordinatesShared );
+    return ColumnCoordinatesSpan( m_PackedColumnCoordinates->data()+m_PackedColumnOffsets[vertexId], this->GetNumberOfColumns(vertexId) );
+  }
+  ColumnCoordinatesContainer* columnCoordinates = this->GetColumnCoordinates( vertexId );
+  return ColumnCoordinatesSpan( columnCoordinates->CastToSTLContainer().data(), columnCoordinates->Size() );
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+typename OSFSurface<TCostType, TSurfaceMeshTraits>::ConstColumnCostsSpan
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetColumnCostsSpan(VertexIdentifier vertexId) const
+{
+  if ( this->GetColumnsPacked() )
+    return ConstColumnCostsSpan( m_PackedColumnCosts->data()+m_PackedColumnOffsets[vertexId], this->GetNumberOfColumns(vertexId) );
+  typename ColumnCostsContainer::Pointer columnCosts;
+  if ( !m_VertexColumnCostsContainer->GetElementIfIndexExists(vertexId,&columnCosts) || !columnCosts )
+    return ConstColumnCostsSpan();
+  return ConstColumnCostsSpan( columnCosts->CastToSTLConstContainer().data(), columnCosts->Size() );
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+typename OSFSurface<TCostType, TSurfaceMeshTraits>::ColumnCostsSpan
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetWritableColumnCostsSpan(VertexIdentifier vertexId)
+{
+  if ( this->GetColumnsPacked() )
+  {
+    this->DetachPackedColumns( m_PackedColumnCosts, m_PackedColumnCostsShared );
+    this->MarkColumnDirty( vertexId );
+    return ColumnCostsSpan( m_PackedColumnCosts->data()+m_PackedColumnOffsets[vertexId], this->GetNumberOfColumns(vertexId) );
+  }
+  ColumnCostsContainer* columnCosts = this->GetColumnCosts( vertexId );
+  return ColumnCostsSpan( columnCosts->CastToSTLContainer().data(), columnCosts->Size() );
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+template <typename TContainer>
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::DetachPackedColumns(std::shared_ptr< TContainer >& buffer, std::atomic<bool>& shared)
+{
+  // double-checked, so only the first of several concurrent writers copies the buffer
+  if ( !shared.load(std::memory_order_acquire) )
+    return;
+  std::lock_guard<std::mutex> lock( m_PackedColumnsMutex );
+  if ( !shared.load(std::memory_order_relaxed) )
+    return;
+  if ( buffer.use_count()>1 )
+    buffer = std::make_shared< TContainer >( *buffer );
+  shared.store( false, std::memory_order_release );
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+bool
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::PackColumns()
+{
+  if ( this->GetColumnsPacked() )
+    return true;
+
+  // the costs share the offsets of the coordinates
+  const VertexIdentifier numVertices = this->GetNumberOfVertices();
+  PackedColumnOffsetsContainer offsets( numVertices+1, 0 );
+  for (VertexIdentifier vertexId=0; vertexId<numVertices; vertexId++)
+  {
+    offsets[vertexId+1] = offsets[vertexId]+this->GetNumberOfColumns( vertexId );
+    if ( this->GetColumnCostsSpan( vertexId ).size()!=offsets[vertexId+1]-offsets[vertexId] )
+      return false;
+  }
+
+  auto coordinates = std::make_shared< PackedColumnCoordinatesContainer >( offsets.back() );
+  auto costs = std::make_shared< PackedColumnCostsContainer >( offsets.back() );
+  for (VertexIdentifier vertexId=0; vertexId<numVertices; vertexId++)
+  {
+    const ConstColumnCoordinatesSpan columnCoordinates = this->GetColumnCoordinatesSpan( vertexId );
+    const ConstColumnCostsSpan columnCosts = this->GetColumnCostsSpan( vertexId );
+    std::copy( columnCoordinates.begin(), columnCoordinates.end(), coordinates->begin()+offsets[vertexId] );
+    std::copy( columnCosts.begin(), columnCosts.end(), costs->begin()+offsets[vertexId] );
+  }
+  m_PackedColumnOffsets.swap( offsets );
+  m_PackedColumnCoordinates = coordinates;
+  m_PackedColumnCosts = costs;
+  m_PackedColumnCoordinatesShared = false;
+  m_PackedColumnCostsShared = false;
+  m_VertexColumnCoordinatesContainer->Initialize();
+  m_VertexColumnCostsContainer->Initialize();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::UnpackColumns()
+{
+  if ( !this->GetColumnsPacked() )
+    return;
+
+  const VertexIdentifier numVertices = this->GetNumberOfVertices();
+  const PackedColumnCoordinatesContainer& coordinates = *m_PackedColumnCoordinates;
+  const PackedColumnCostsContainer& costs = *m_PackedColumnCosts;
+  m_VertexColumnCoordinatesContainer->Reserve( numVertices );
+  m_VertexColumnCostsContainer->Reserve( numVertices );
+  for (VertexIdentifier vertexId=0; vertexId<numVertices; vertexId++)
+  {
+    typename ColumnCoordinatesContainer::Pointer columnCoordinates = ColumnCoordinatesContainer::New();
+    columnCoordinates->CastToSTLContainer().assign( coordinates.begin()+m_PackedColumnOffsets[vertexId], coordinates.begin()+m_PackedColumnOffsets[vertexId+1] );
+    m_VertexColumnCoordinatesContainer->SetElement( vertexId, columnCoordinates );
+    typename ColumnCostsContainer::Pointer columnCosts = ColumnCostsContainer::New();
+    columnCosts->CastToSTLContainer().assign( costs.begin()+m_PackedColumnOffsets[vertexId], costs.begin()+m_PackedColumnOffsets[vertexId+1] );
+    m_VertexColumnCostsContainer->SetElement( vertexId, columnCosts );
+  }
+  PackedColumnOffsetsContainer().swap( m_PackedColumnOffsets );
+  m_PackedColumnCoordinates = std::make_shared< PackedColumnCoordinatesContainer >();
+  m_PackedColumnCosts = std::make_shared< PackedColumnCostsContainer >();
+  m_PackedColumnCoordinatesShared = false;
+  m_PackedColumnCostsShared = false;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+bool
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetColumnsPacked() const
+{
+  return !m_PackedColumnOffsets.empty();
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+const typename OSFSurface<TCostType, TSurfaceMeshTraits>::PackedColumnOffsetsContainer&
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetPackedColumnOffsets() const
+{
+  return m_PackedColumnOffsets;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+const typename OSFSurface<TCostType, TSurfaceMeshTraits>::PackedColumnCoordinatesContainer&
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetPackedColumnCoordinates() const
+{
+  return *m_PackedColumnCoordinates;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+const typename OSFSurface<TCostType, TSurfaceMeshTraits>::PackedColumnCostsContainer&
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetPackedColumnCosts() const
+{
+  return *m_PackedColumnCosts;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+typename OSFSurface<TCostType, TSurfaceMeshTraits>::PackedColumnCostsContainer&
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetWritablePackedColumnCosts()
+{
+  this->DetachPackedColumns( m_PackedColumnCosts, m_PackedColumnCostsShared );
+  this->MarkAllColumnsDirty();
+  return *m_PackedColumnCosts;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::SetPackedColumns(const PackedColumnOffsetsContainer& offsets, const PackedColumnCoordinatesContainer& coordinates, const PackedColumnCostsContainer& costs)
+{
+  if ( offsets.empty() || coordinates.size()!=offsets.back() || costs.size()!=offsets.back() )
+    itkExceptionMacro( "Packed columns do not match their offsets." );
+  m_PackedColumnOffsets = offsets;
+  m_PackedColumnCoordinates = std::make_shared< PackedColumnCoordinatesContainer >( coordinates );
+  m_PackedColumnCosts = std::make_shared< PackedColumnCostsContainer >( costs );
+  m_PackedColumnCoordinatesShared = false;
+  m_PackedColumnCostsShared = false;
+  m_VertexColumnCoordinatesContainer->Initialize();
+  m_VertexColumnCostsContainer->Initialize();
+  this->MarkAllColumnsDirty();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::ShareSurface(const Self* surface)
+{
+  if ( surface==this )
+    return;
+  if ( !surface->GetColumnsPacked() )
+    itkExceptionMacro( "Only surfaces with packed columns can be shared." );
+
+  m_PackedColumnOffsets = surface->m_PackedColumnOffsets;
+  m_PackedColumnCoordinates = surface->m_PackedColumnCoordinates;
+  m_PackedColumnCosts = surface->m_PackedColumnCosts;
+  m_PackedColumnCoordinatesShared = true;
+  m_PackedColumnCostsShared = true;
+  surface->m_PackedColumnCoordinatesShared = true;
+  surface->m_PackedColumnCostsShared = true;
+  m_VertexColumnCoordinatesContainer->Initialize();
+  m_VertexColumnCostsContainer->Initialize();
+
+  m_VertexInitialPositionIdentifierContainer->CastToSTLContainer() = surface->m_VertexInitialPositionIdentifierContainer->CastToSTLConstContainer();
+  m_VertexCurrentPositionIdentifierContainer->CastToSTLContainer() = surface->m_VertexCurrentPositionIdentifierContainer->CastToSTLConstContainer();
+  m_DirtyColumns = surface->m_DirtyColumns;
+  m_DirtyColumnsTracked = surface->m_DirtyColumnsTracked.load();
+
+  // cells are only released by the last surface holding them (see ReleaseCellsMemory())
+  this->SetCells( const_cast<CellsContainer*>( surface->GetCells() ) );
+  this->CopyNeighborLookupTable( surface );
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::ClearDirtyColumns()
+{
+  m_DirtyColumns.assign( this->GetNumberOfVertices(), 0 );
+  m_DirtyColumnsTracked = true;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+bool
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetDirtyColumnsTracked() const
+{
+  return m_DirtyColumnsTracked;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+bool
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::GetColumnCostsDirty(VertexIdentifier vertexId) const
+{
+  return !m_DirtyColumnsTracked || vertexId>=m_DirtyColumns.size() || m_DirtyColumns[vertexId]!=0;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::MarkAllColumnsDirty()
+{
+  m_DirtyColumnsTracked = false;
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::MarkColumnDirty(VertexIdentifier vertexId)
+{
+  // the marks are not resized, so writers of different columns may run concurrently; unknown vertices invalidate them
+  if ( !m_DirtyColumnsTracked.load(std::memory_order_relaxed) )
+    return;
+  if ( vertexId<m_DirtyColumns.size() )
+    m_DirtyColumns[vertexId] = 1;
+  else
+    m_DirtyColumnsTracked = false;
+}
+
 //----------------------------------------------------------------------------
 template <typename TCostType, typename TSurfaceMeshTraits >
 const typename OSFSurface<TCostType, TSurfaceMeshTraits>::CoordinateType&
@@ -134,7 +426,7 @@ OSFSurface<TCostType, TSurfaceMeshTraits>
 {
   const ColumnPositionIdentifier columnId = this->GetInitialVertexPositionIdentifier( vertexId );
   // todo: checks if it exists or not possible, but what to return in this case?
-  return m_VertexColumnCoordinatesContainer->GetElement(vertexId)->ElementAt(columnId);
+  return this->GetColumnCoordinatesSpan(vertexId)[columnId];
 }
 
 //----------------------------------------------------------------------------
@@ -174,7 +466,7 @@ OSFSurface<TCostType, TSurfaceMeshTraits>
 {
   const ColumnPositionIdentifier columnId = this->GetCurrentVertexPositionIdentifier( vertexId );
   // todo: checks if it exists or not possible, but what to return in this case?
-  return m_VertexColumnCoordinatesContainer->GetElement(vertexId)->ElementAt(columnId);
+  return this->GetColumnCoordinatesSpan(vertexId)[columnId];
 }
 
 //----------------------------------------------------------------------------
@@ -371,6 +663,25 @@ OSFSurface<TCostType, TSurfaceMeshTraits>
   }
 }
 
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+bool
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::HasNeighborLookupTable() const
+{
+  return m_VertexNeighborLookupTable.IsNotNull();
+}
+
+//----------------------------------------------------------------------------
+template <typename TCostType, typename TSurfaceMeshTraits >
+void
+OSFSurface<TCostType, TSurfaceMeshTraits>
+::CopyNeighborLookupTable(const Self* surface)
+{
+  // note: the lookup table is never modified after BuildNeighborLookupTable(), so it can be shared
+  m_VertexNeighborLookupTable = surface ? surface->m_VertexNeighborLookupTable : nullptr;
+}
+
 //----------------------------------------------------------------------------
 template <typename TCostType, typename TSurfaceMeshTraits >
 void
@@ -37,6 +37,8 @@ namespace itk
  * \author	Christian Bauer, Markus Van Tol
  * Merges a new object segmentation with the segmentation of other objects.  If set, avoids overwriting
  * old objects and seals gaps between the new object and old objects or more of the new object.
+ * If an active region is set, the new object segmentation must be empty outside of it.  Only the active
+ * region plus a one voxel margin is merged; the other voxels are copied from the label image.
  * Template parameters for class SealingSegmentationMergerImageFilter:
  *
  * - TInputImage = The image type of the new segmentation to be incorporated.
@@ -104,6 +106,10 @@ public:
   itkSetMacro(NecroticRegion, bool);
   itkGetMacro(NecroticRegion, bool);
 
+  /** Region containing the new object segmentation.  An empty region, the default, merges the whole image. */
+  itkSetMacro(ActiveRegion, OutputImageRegionType);
+  itkGetConstReferenceMacro(ActiveRegion, OutputImageRegionType);
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro(ImageDimensionCheck,
@@ -126,6 +132,7 @@ private:
   bool m_Sealing{ false };
   bool m_PaintOver{ false };
   bool m_NecroticRegion{ false };
+  OutputImageRegionType m_ActiveRegion;
   typename InputImageType::Pointer m_LabelImage;
   typename UptakeImageType::Pointer m_DataImage;
 };
@@ -59,34 +59,72 @@ SealingSegmentationMergerImageFilter<TInputImage, TUptakeImage, TOutputImage>
   InputRadiusType radius;
   radius.Fill(1);
 
-  InputNeighborhoodIteratorType inputIt(radius, this->GetInput(), outputRegionForThread); //iterator for newly created label
-  InputNeighborhoodIteratorType segmentationIt(radius, this->GetLabelImage(), outputRegionForThread); //iterator for existing labels
-  UptakeIteratorType uptakeIt(this->GetDataImage(), outputRegionForThread);
-  OutputIteratorType outputIt(this->GetOutput(), outputRegionForThread);
-  while (!outputIt.IsAtEnd()) //Zero out any data left over from old memory
+  // outside of the active region plus the margin of the sealing neighborhood, there is nothing new to merge, so the existing labels are copied
+  OutputImageRegionType activeRegionForThread = outputRegionForThread;
+  bool active = true;
+  if (m_ActiveRegion.GetNumberOfPixels()>0)
   {
-    outputIt.Set(0);
-    ++outputIt;
+    OutputImageRegionType activeRegion = m_ActiveRegion;
+    activeRegion.PadByRadius(1);
+    active = activeRegionForThread.Crop(activeRegion);
+    // the part of the thread region outside of the active region is split into slabs below and above it in each dimension,
+    // so every voxel is written exactly once, either by the copy or by the merge
+    OutputImageRegionType remainingRegion = outputRegionForThread;
+    for (unsigned int dim=0; dim<OutputImageDimension; ++dim)
+    {
+      const IndexValueType remainingStart = remainingRegion.GetIndex(dim);
+      const IndexValueType remainingEnd = remainingStart + static_cast<IndexValueType>(remainingRegion.GetSize(dim));
+      IndexValueType activeStart = activeRegionForThread.GetIndex(dim);
+      IndexValueType activeEnd = activeStart + static_cast<IndexValueType>(activeRegionForThread.GetSize(dim));
+      if (!active)
+        activeStart = activeEnd = remainingEnd;
+      for (int side=0; side<2; ++side)
+      {
+        OutputImageRegionType slab = remainingRegion;
+        slab.SetIndex(dim, side==0 ? remainingStart : activeEnd);
+        slab.SetSize(dim, static_cast<SizeValueType>(side==0 ? activeStart-remainingStart : remainingEnd-activeEnd));
+        if (slab.GetNumberOfPixels()==0)
+          continue;
+        ImageRegionConstIterator<InputImageType> labelIt(this->GetLabelImage(), slab);
+        OutputIteratorType copyIt(this->GetOutput(), slab);
+        while (!copyIt.IsAtEnd())
+        {
+          copyIt.Set(labelIt.Get());
+          ++labelIt;
+          ++copyIt;
+        }
+      }
+      if (!active)
+        break;
+      remainingRegion.SetIndex(dim, activeStart);
+      remainingRegion.SetSize(dim, static_cast<SizeValueType>(activeEnd-activeStart));
+    }
   }
-  outputIt.GoToBegin();
+  if (!active)
+    return;
+
+  InputNeighborhoodIteratorType inputIt(radius, this->GetInput(), activeRegionForThread); //iterator for newly created label
+  InputNeighborhoodIteratorType segmentationIt(radius, this->GetLabelImage(), activeRegionForThread); //iterator for existing labels
+  UptakeIteratorType uptakeIt(this->GetDataImage(), activeRegionForThread);
+  OutputIteratorType outputIt(this->GetOutput(), activeRegionForThread);
   while (!inputIt.IsAtEnd())  //Apply the existing labels and the actual sealing
   {
+    OutputImagePixelType value = 0; //Every voxel is set once, so there is no need to zero out data left over from old memory first
     if (inputIt.GetCenterPixel()>0 && (segmentationIt.GetCenterPixel()==0 || m_PaintOver))  //If the new label is to be applied and either the existing one is blank or set to be painted over, then apply the new label
-      outputIt.Set(m_Label);
+      value = m_Label;
     else if (segmentationIt.GetCenterPixel()>0) //Otherwise, if there's an existing label, apply it
-      outputIt.Set(segmentationIt.GetCenterPixel());
+      value = segmentationIt.GetCenterPixel();
     else if (m_Sealing && (uptakeIt.Get()>=m_Threshold || m_NecroticRegion))  //Otherwise, if sealing's active and the voxel is either above the threshold or the region is marked necrotic, thereby ignoring the threshold, then check if the voxel must be sealed
     {
       for (int dim=0; dim<3; ++dim) //check each dimension
       {
         if (inputIt.GetPrevious(dim)>0 && (segmentationIt.GetNext(dim)>0 || inputIt.GetNext(dim)>0))  //If previous in this dimension is a new label and next is a new or old label, seal with new label
-          outputIt.Set(m_Label);
+          value = m_Label;
         else if (inputIt.GetNext(dim)>0 && (segmentationIt.GetPrevious(dim)>0 || inputIt.GetPrevious(dim)>0)) //If next in this dimension is a new label and previous is a new or old label, seal with new label
-          outputIt.Set(m_Label);
+          value = m_Label;
       }
     }
-    else
-      outputIt.Set(0);
+    outputIt.Set(value);
 
     ++inputIt;
     ++segmentationIt;
@@ -60,6 +60,31 @@ public:
   
   itkSetMacro( SoftSmoothnessPenalty, double );
   itkGetMacro( SoftSmoothnessPenalty, double ); 
+  
+  /** Create the intra-column and smoothness edges of the graph, default is on. Solver engines generating these
+   * arcs from the column topology (LOGISMOSOSFGraphSolverFilter::ImplicitArcs) only need the nodes and the
+   * neighbor lookup table of the surfaces, so the edges can be skipped. */
+  itkSetMacro( CreateEdges, bool );
+  itkGetMacro( CreateEdges, bool );
+  itkBooleanMacro( CreateEdges );
+
+  /** Graph built by this filter with the same settings for a graph with the same surfaces, vertices, cells and
+   * column sizes (e.g. the unit sphere the columns of the input were translated from). If the nodes of the input
+   * match the nodes of the template, the node lookup table, the neighbor lookup tables and the edges are copied
+   * from the template instead of being rebuilt; otherwise the template is ignored. */
+  itkSetConstObjectMacro( GraphTemplate, OutputOSFGraphType );
+  itkGetConstObjectMacro( GraphTemplate, OutputOSFGraphType );
+
+  /** Keep the output of an update (copy-on-write) to update the next output from it, default is off. If the input
+   * surfaces track their dirty columns relative to the input of the previous update (OSFSurface::ClearDirtyColumns())
+   * and the settings, vertices, cells and column sizes did not change, the output shares the lookup tables and the
+   * edges of the previous output and only the nodes of the dirty columns are created again. */
+  itkSetMacro( UpdateDirtyColumnsOnly, bool );
+  itkGetMacro( UpdateDirtyColumnsOnly, bool );
+  itkBooleanMacro( UpdateDirtyColumnsOnly );
+
+  /** Returns true if the last update only created the nodes of the dirty columns. */
+  itkGetConstMacro( DirtyColumnsUpdated, bool );
     
 protected:
   /** Constructor for use by New() method. */
@@ -72,9 +97,16 @@ protected:
   using SurfaceIdentifier = typename OutputOSFGraphType::VertexIdentifier;
   using OSFSurface = typename OutputOSFGraphType::OSFSurface;
   using VertexIdentifier = typename OSFSurface::VertexIdentifier;
+  using GraphNodeIdentifier = typename OutputOSFGraphType::GraphNodeIdentifier;
+  virtual void BuildGraph();
+  virtual void UpdateNodesOfDirtyColumns();
   virtual void CreateNodesForColumn(SurfaceIdentifier surfaceId, VertexIdentifier vertexId);
+  virtual void SetNodesForColumn(SurfaceIdentifier surfaceId, VertexIdentifier vertexId, GraphNodeIdentifier startNodeIndex);
   virtual void CreateIntraColumnArcsForColumn(SurfaceIdentifier surfaceId, VertexIdentifier vertexId);
   virtual void CreateInterColumnArcsForColumn(SurfaceIdentifier surfaceId, VertexIdentifier vertexId);
+  bool GraphTemplateMatchesOutput();
+  bool PreviousOutputMatchesOutput();
+  void KeepPreviousOutput();
   
   // note: shanhui said that some people say the value has to be a large negative number
   // but he did not experience any negative effects
@@ -84,6 +116,16 @@ protected:
   
   unsigned int m_SmoothnessConstraint{ itk::NumericTraits<unsigned int>::max() };
   double m_SoftSmoothnessPenalty{ 0 };
+  bool m_CreateEdges{ true };
+  typename OutputOSFGraphType::ConstPointer m_GraphTemplate;
+  bool m_UpdateDirtyColumnsOnly{ false };
+  bool m_DirtyColumnsUpdated{ false };
+
+  // output of the previous update and the settings it was built with (only kept if UpdateDirtyColumnsOnly)
+  typename OutputOSFGraphType::Pointer m_PreviousOutput;
+  unsigned int m_PreviousSmoothnessConstraint{ 0 };
+  double m_PreviousSoftSmoothnessPenalty{ 0 };
+  bool m_PreviousCreateEdges{ false };
   
 private:
 }; // end class SimpleOSFGraphBuilderFilter
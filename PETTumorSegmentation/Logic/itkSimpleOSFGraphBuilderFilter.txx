@@ -31,8 +31,30 @@ SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
 ::GenerateData()
 {
   this->CopyInputOSFGraphToOutputOSFGraphSurfaces();
+
+  // only the columns written since the previous update changed -> update their nodes in the previous output
+  m_DirtyColumnsUpdated = this->PreviousOutputMatchesOutput();
+  if (m_DirtyColumnsUpdated)
+    this->UpdateNodesOfDirtyColumns();
+  else
+    this->BuildGraph();
+
+  if (m_UpdateDirtyColumnsOnly)
+    this->KeepPreviousOutput();
+  else
+    m_PreviousOutput = nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+void
+SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
+::BuildGraph()
+{
   auto output = this->GetOutput();
-  
+  output->SetNodes( OutputOSFGraphType::GraphNodesContainer::New() ); // the output of a previous update is replaced
+  output->SetEdges( OutputOSFGraphType::GraphEdgesContainer::New() );
+
   // create nodes for columns
   for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
   {
@@ -40,8 +62,28 @@ SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
     for (VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
       this->CreateNodesForColumn(surfaceId, vertexId);
   }
+
+  // same topology as the template -> reuse its lookup tables and edges
+  if (this->GraphTemplateMatchesOutput())
+  {
+    output->CopyGraphNodeIdentifierLookupTable(m_GraphTemplate);
+    for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+      output->GetSurface(surfaceId)->CopyNeighborLookupTable(m_GraphTemplate->GetSurface(surfaceId));
+    if (m_CreateEdges)
+      output->GetEdges()->CastToSTLContainer() = m_GraphTemplate->GetEdges()->CastToSTLConstContainer();
+    return;
+  }
+
   output->BuildGraphNodeIdentifierLookupTable();
  
+  // arcs are generated on the fly by the solver, only the neighborhood is needed
+  if (!m_CreateEdges)
+  {
+    for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+      output->GetSurface(surfaceId)->BuildNeighborLookupTable();
+    return;
+  }
+
   // create intra-column arcs
   for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
   {
@@ -61,37 +103,63 @@ SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
   
 }
 
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+void
+SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
+::UpdateNodesOfDirtyColumns()
+{
+  // the nodes are copied by the first column written, the lookup tables and the edges stay shared
+  auto output = this->GetOutput();
+  output->ShareNodesAndEdges(m_PreviousOutput);
+  for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+  {
+    typename OSFSurface::Pointer surface = output->GetSurface(surfaceId);
+    surface->CopyNeighborLookupTable(m_PreviousOutput->GetSurface(surfaceId));
+    for (VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+      if (surface->GetColumnCostsDirty(vertexId) && surface->GetColumnCostsSpan(vertexId).size()>0)
+        this->SetNodesForColumn(surfaceId, vertexId, output->GetNodeIdentifer(surfaceId, vertexId, 0));
+  }
+}
+
 //----------------------------------------------------------------------------
 template <class TInputOSFGraph, class TOutputOSFGraph>
 void
 SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
 ::CreateNodesForColumn(SurfaceIdentifier surfaceId, VertexIdentifier vertexId)
+{
+  auto output = this->GetOutput();
+  typename OutputOSFGraphType::GraphNodesContainer::Pointer graphNodes = output->GetNodes();
+  GraphNodeIdentifier startNodeIndex = graphNodes->Size();
+  graphNodes->Reserve( graphNodes->Size()+output->GetSurface(surfaceId)->GetColumnCostsSpan(vertexId).size() );
+  this->SetNodesForColumn(surfaceId, vertexId, startNodeIndex);
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+void
+SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
+::SetNodesForColumn(SurfaceIdentifier surfaceId, VertexIdentifier vertexId, GraphNodeIdentifier startNodeIndex)
 {
   using GraphNode = typename OutputOSFGraphType::GraphNode;
   
   auto output = this->GetOutput();
-  typename OSFSurface::ColumnCostsContainer::ConstPointer columnCosts = output->GetSurface(surfaceId)->GetColumnCosts(vertexId);
-  typename OSFSurface::ColumnCostsContainer::ConstIterator columnCostsItr = columnCosts->Begin();
-  typename OSFSurface::ColumnCostsContainer::ConstIterator columnCostsEnd = columnCosts->End();
+  typename OSFSurface::ConstColumnCostsSpan columnCosts = output->GetSurface(surfaceId)->GetColumnCostsSpan(vertexId);
   typename OutputOSFGraphType::GraphNodesContainer::Pointer graphNodes = output->GetNodes();
-  typename OutputOSFGraphType::GraphNodeIdentifier startNodeIndex = graphNodes->Size();
-  graphNodes->Reserve( graphNodes->Size()+columnCosts->Size() );
   
-  if (columnCosts->Size()>0)
+  if (columnCosts.size()>0)
   {
     typename OutputOSFGraphType::GraphCosts weight = 0;
-    typename OutputOSFGraphType::GraphCosts previousNodeCost = columnCostsItr.Value();
-    graphNodes->SetElement( startNodeIndex++, GraphNode(surfaceId, vertexId, columnCostsItr->Index(), -m_ColumnBasedNodeWeight, 0) ); // set node of base to default value
-    ++columnCostsItr;
-    while (columnCostsItr!=columnCostsEnd)
+    typename OutputOSFGraphType::GraphCosts previousNodeCost = columnCosts[0];
+    graphNodes->SetElement( startNodeIndex++, GraphNode(surfaceId, vertexId, 0, -m_ColumnBasedNodeWeight, 0) ); // set node of base to default value
+    for (typename OSFSurface::ColumnPositionIdentifier columnPositionId=1; columnPositionId<columnCosts.size(); columnPositionId++)
     {
-      weight = columnCostsItr.Value()-previousNodeCost;
+      weight = columnCosts[columnPositionId]-previousNodeCost;
       if (weight>0) // non-negative -> connect to t
-        graphNodes->SetElement( startNodeIndex++, GraphNode(surfaceId, vertexId, columnCostsItr->Index(), 0.0, weight) );
+        graphNodes->SetElement( startNodeIndex++, GraphNode(surfaceId, vertexId, columnPositionId, 0.0, weight) );
       else // negative -> connect to s
-        graphNodes->SetElement( startNodeIndex++, GraphNode(surfaceId, vertexId, columnCostsItr->Index(), -weight, 0.0) );
-      previousNodeCost = columnCostsItr.Value();
-      ++columnCostsItr;
+        graphNodes->SetElement( startNodeIndex++, GraphNode(surfaceId, vertexId, columnPositionId, -weight, 0.0) );
+      previousNodeCost = columnCosts[columnPositionId];
     }
   }
   
@@ -166,6 +234,87 @@ SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
   }
 }
 
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+bool
+SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
+::GraphTemplateMatchesOutput()
+{
+  if (m_GraphTemplate.IsNull())
+    return false;
+  auto output = this->GetOutput();
+  if (m_GraphTemplate->GetNumberOfSurfaces()!=output->GetNumberOfSurfaces() || m_GraphTemplate->GetNumberOfNodes()!=output->GetNumberOfNodes())
+    return false;
+  if (m_CreateEdges && m_GraphTemplate->GetNumberOfEdges()==0)
+    return false;
+  for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+  {
+    const OSFSurface* templateSurface = m_GraphTemplate->GetSurface(surfaceId);
+    const OSFSurface* surface = output->GetSurface(surfaceId);
+    if (!templateSurface->HasNeighborLookupTable() || templateSurface->GetNumberOfVertices()!=surface->GetNumberOfVertices() || templateSurface->GetNumberOfCells()!=surface->GetNumberOfCells())
+      return false;
+  }
+  
+  // nodes are created from the column costs, so equal nodes mean equal column sizes
+  auto templateNodeItr = m_GraphTemplate->GetNodes()->Begin();
+  for (auto nodeItr=output->GetNodes()->Begin(); nodeItr!=output->GetNodes()->End(); ++nodeItr, ++templateNodeItr)
+  {
+    const auto& node = nodeItr.Value();
+    const auto& templateNode = templateNodeItr.Value();
+    if (node.surfaceId!=templateNode.surfaceId || node.vertexId!=templateNode.vertexId || node.positionId!=templateNode.positionId)
+      return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+bool
+SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
+::PreviousOutputMatchesOutput()
+{
+  if (!m_UpdateDirtyColumnsOnly || m_PreviousOutput.IsNull())
+    return false;
+  if (m_PreviousSmoothnessConstraint!=m_SmoothnessConstraint || m_PreviousSoftSmoothnessPenalty!=m_SoftSmoothnessPenalty || m_PreviousCreateEdges!=m_CreateEdges)
+    return false;
+  auto output = this->GetOutput();
+  if (m_PreviousOutput->GetNumberOfSurfaces()!=output->GetNumberOfSurfaces())
+    return false;
+  for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+  {
+    const OSFSurface* previousSurface = m_PreviousOutput->GetSurface(surfaceId);
+    const OSFSurface* surface = output->GetSurface(surfaceId);
+    if (!surface->GetDirtyColumnsTracked() || previousSurface->GetNumberOfVertices()!=surface->GetNumberOfVertices() || previousSurface->GetNumberOfCells()!=surface->GetNumberOfCells())
+      return false;
+    for (VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+      if (previousSurface->GetColumnCostsSpan(vertexId).size()!=surface->GetColumnCostsSpan(vertexId).size())
+        return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class TInputOSFGraph, class TOutputOSFGraph>
+void
+SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
+::KeepPreviousOutput()
+{
+  // copy-on-write like CloneOSFGraphFilter, which needs packed columns to share the surfaces
+  auto output = this->GetOutput();
+  m_PreviousOutput = nullptr;
+  for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+    if (!output->GetSurface(surfaceId)->GetColumnsPacked())
+      return;
+
+  m_PreviousOutput = OutputOSFGraphType::New();
+  for (SurfaceIdentifier surfaceId=0; surfaceId<output->GetNumberOfSurfaces(); surfaceId++)
+    m_PreviousOutput->GetSurface(surfaceId)->ShareSurface(output->GetSurface(surfaceId));
+  m_PreviousOutput->ShareNodesAndEdges(output);
+  m_PreviousSmoothnessConstraint = m_SmoothnessConstraint;
+  m_PreviousSoftSmoothnessPenalty = m_SoftSmoothnessPenalty;
+  m_PreviousCreateEdges = m_CreateEdges;
+}
+
 //----------------------------------------------------------------------------
 template <class TInputOSFGraph, class TOutputOSFGraph>
 void
@@ -173,6 +322,11 @@ SimpleOSFGraphBuilderFilter<TInputOSFGraph, TOutputOSFGraph>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "SmoothnessConstraint: " << m_SmoothnessConstraint << std::endl;
+  os << indent << "SoftSmoothnessPenalty: " << m_SoftSmoothnessPenalty << std::endl;
+  os << indent << "CreateEdges: " << m_CreateEdges << std::endl;
+  os << indent << "GraphTemplate: " << m_GraphTemplate.GetPointer() << std::endl;
+  os << indent << "UpdateDirtyColumnsOnly: " << m_UpdateDirtyColumnsOnly << std::endl;
   // todo: implement
 }
 
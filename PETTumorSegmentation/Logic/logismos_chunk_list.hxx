@@ -20,6 +20,7 @@
 
 #include <cstddef>  // for std::size_t
 #include <cstring>  // for std::memset
+#include <memory>   // for std::allocator_traits
 #include <vector>
 #include <iostream> // for testing only
 
@@ -81,11 +82,16 @@ public:
 /// 3) using scan_first() and scan_next() to sequentially access all elements is efficient (should be similar to std::vector);
 /// 4) random access using ptr_at() or operator [] is easy and should be good enough
 /// but may not be very efficient for sequential access of all elements.
-template <typename _T, std::size_t _N>
+/// The chunks and the list of chunks are allocated by _Alloc rebound to their types,
+/// _Alloc has to be default constructible.
+template <typename _T, std::size_t _N, typename _Alloc = std::allocator<_T> >
 class chunk_list
 {
   typedef chunk<_T, _N>                 chunk_type;
-  typedef std::vector<chunk_type*>      list_type;
+  typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<chunk_type>   chunk_alloc_type;
+  typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<chunk_type*>  list_alloc_type;
+  typedef std::allocator_traits<chunk_alloc_type>   chunk_alloc_traits;
+  typedef std::vector<chunk_type*, list_alloc_type> list_type;
   typedef typename list_type::iterator  list_iter_type;
 
 private:
@@ -95,6 +101,23 @@ private:
   _T*             m_data_ptr;   ///< pointer to the current element of type _T being accessed
   list_iter_type  m_chunk_iter; ///< iterator of the current chunk being accessed
 
+  /// \brief Allocates a new chunk (zero-filled by its constructor).
+  inline chunk_type* new_chunk()
+  {
+    chunk_alloc_type alloc;
+    chunk_type* p_chunk = chunk_alloc_traits::allocate(alloc, 1);
+    chunk_alloc_traits::construct(alloc, p_chunk);
+    return p_chunk;
+  }
+  
+  /// \brief Releases a chunk allocated by new_chunk().
+  inline void delete_chunk(chunk_type* p_chunk)
+  {
+    chunk_alloc_type alloc;
+    chunk_alloc_traits::destroy(alloc, p_chunk);
+    chunk_alloc_traits::deallocate(alloc, p_chunk, 1);
+  }
+
 public:
   /// \brief Constructor
   chunk_list() : m_size(0), m_data_ptr(0){  }
@@ -106,7 +129,7 @@ public:
   void clear()
   {
     m_size = 0; m_data_ptr = 0;
-    for(list_iter_type iter = m_list.begin(); iter != m_list.end(); ++iter){  delete *iter; }
+    for(list_iter_type iter = m_list.begin(); iter != m_list.end(); ++iter){  delete_chunk(*iter); }
     m_list.clear();
     list_type().swap(m_list);   // actually frees memory allocated if list_type is std::vector
   }
@@ -154,7 +177,7 @@ public:
   inline _T* grow()
   {
     if(m_list.empty() || m_list.back()->size() == _N){  // list is empty or the last chunk is full
-      m_list.push_back(new chunk_type()); // create a new chunk
+      m_list.push_back(new_chunk()); // create a new chunk
     } 
     m_size++;
     return m_list.back()->grow();
@@ -173,7 +196,7 @@ public:
     
     if(cnt == 1){ grow(); return old_size;  }
     if(m_list.empty() || m_list.back()->size() == _N){  // list is empty or the last chunk is full
-      m_list.push_back(new chunk_type()); // create a new chunk
+      m_list.push_back(new_chunk()); // create a new chunk
     }
     
     std::size_t grow_slots = cnt;
@@ -189,11 +212,11 @@ public:
     std::size_t chunk_cnt = grow_slots / _N;  // number of chunk to grow
     std::size_t extra_cnt = grow_slots % _N;  // number of additional elements to grow that is not a full chunk
     for(std::size_t i=0;i<chunk_cnt;++i){
-      m_list.push_back(new chunk_type()); 
+      m_list.push_back(new_chunk()); 
       m_list.back()->grow(_N);  m_size += _N;
     }
     if(extra_cnt > 0){
-      m_list.push_back(new chunk_type()); 
+      m_list.push_back(new_chunk()); 
       m_list.back()->grow(extra_cnt); m_size += extra_cnt;
     }
     return old_size;
@@ -18,16 +18,27 @@
 namespace LOGISMOS{
 
 ////////////////////////////////////////////////////////
-template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize>
-_Cap graph<_Cap, _DataChunkSize, _PtrChunkSize>::solve()
+template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize, typename _Alloc>
+_Cap graph<_Cap, _DataChunkSize, _PtrChunkSize, _Alloc>::solve(bool reuse_trees)
 {
-  // make sure we start from correct initial condition
-  m_orphan_nodes.clear();
-  
   node* p_node;
   edge* p_edge;
   
-  p_node=m_nodes.scan_first();
+  if(reuse_trees){
+    // only nodes affected by capacity changes are activated
+    restore_trees();
+    p_node = 0;
+  }
+  else{
+    // make sure we start from correct initial condition
+    m_orphan_nodes.clear();
+    while(m_marked_nodes.empty() == false){
+      m_marked_nodes.front()->set_marked(false);
+      m_marked_nodes.pop_front();
+    }
+    p_node=m_nodes.scan_first();
+  }
+  
   while(p_node){
     if(p_node->has_parent() == false || p_node->is_active() == false)
       p_edge = 0;
@@ -74,13 +85,53 @@ _Cap graph<_Cap, _DataChunkSize, _PtrChunkSize>::solve()
 } 
 
 ////////////////////////////////////////////////////////
-template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize>
-typename graph<_Cap, _DataChunkSize, _PtrChunkSize>::edge* graph<_Cap, _DataChunkSize, _PtrChunkSize>::grow_active_node(node* node_i)
+template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize, typename _Alloc>
+void graph<_Cap, _DataChunkSize, _PtrChunkSize, _Alloc>::restore_trees()
+{
+  m_clock++;
+  
+  while(m_marked_nodes.empty() == false){
+    node* node_i = m_marked_nodes.front();
+    m_marked_nodes.pop_front();
+    node_i->set_marked(false);
+    activate(node_i);
+    
+    if(node_i->m_rcap == 0){  // no terminal capacity left, node has to find a new parent if it had one
+      if(node_i->has_parent())  mark_orphan(node_i);
+      continue;
+    }
+    
+    bool i_is_sink = node_i->m_rcap < 0;
+    if(node_i->has_parent() == false || node_i->is_sink() != i_is_sink){
+      // node i changes its tree: its children become orphans,
+      // neighbors of the other tree that can reach i are activated to find the new connection
+      node_i->set_sink(i_is_sink);
+      for(edge* p_edge = first_out_edge(node_i); p_edge; p_edge = next_out_edge(node_i, p_edge)){
+        node* node_j = p_edge->m_head;
+        if(node_j->is_marked()) continue; // will be processed by itself
+        if(node_j->m_par_edge == p_edge->m_sister)  mark_orphan(node_j);
+        _Cap cap = (i_is_sink) ? p_edge->m_sister->m_rcap : p_edge->m_rcap;
+        if(node_j->has_parent() && node_j->is_sink() != i_is_sink && cap > 0)  activate(node_j);
+      }
+    }
+    node_i->set_terminal();
+    node_i->m_time = m_clock;
+    node_i->m_dist = 1;
+  }
+  
+  while(m_orphan_nodes.empty() == false){
+    adopt_orphan(m_orphan_nodes.front());
+    m_orphan_nodes.pop_front();
+  }
+}
+
+////////////////////////////////////////////////////////
+template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize, typename _Alloc>
+typename graph<_Cap, _DataChunkSize, _PtrChunkSize, _Alloc>::edge* graph<_Cap, _DataChunkSize, _PtrChunkSize, _Alloc>::grow_active_node(node* node_i)
 {
   bool i_is_sink = node_i->is_sink();
   
-  for(edge** edge_dptr  = node_i->m_out_edges->scan_first(); edge_dptr; edge_dptr = node_i->m_out_edges->scan_next()){
-    edge* p_edge = *edge_dptr;
+  for(edge* p_edge = first_out_edge(node_i); p_edge; p_edge = next_out_edge(node_i, p_edge)){
     _Cap  cap = (i_is_sink) ? p_edge->m_sister->m_rcap : p_edge->m_rcap;
     if(cap == 0)  continue; // only check edge with residual capacity
     
@@ -108,8 +159,8 @@ typename graph<_Cap, _DataChunkSize, _PtrChunkSize>::edge* graph<_Cap, _DataChun
 }
 
 ////////////////////////////////////////////////////////
-template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize>
-void graph<_Cap, _DataChunkSize, _PtrChunkSize>::augment_path(edge* mid_edge)
+template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize, typename _Alloc>
+void graph<_Cap, _DataChunkSize, _PtrChunkSize, _Alloc>::augment_path(edge* mid_edge)
 {
   edge* p_edge;
   _Cap cap;
@@ -181,8 +232,8 @@ void graph<_Cap, _DataChunkSize, _PtrChunkSize>::augment_path(edge* mid_edge)
 }
 
 ////////////////////////////////////////////////////////
-template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize>
-void graph<_Cap, _DataChunkSize, _PtrChunkSize>::adopt_orphan(node* node_i)
+template <typename _Cap, std::size_t _DataChunkSize, std::size_t _PtrChunkSize, typename _Alloc>
+void graph<_Cap, _DataChunkSize, _PtrChunkSize, _Alloc>::adopt_orphan(node* node_i)
 {
   bool i_is_sink = node_i->is_sink(); // which tree the orphan node belong, sink (true) or source (false)
   node* node_j;
@@ -194,8 +245,7 @@ void graph<_Cap, _DataChunkSize, _PtrChunkSize>::adopt_orphan(node* node_i)
   unsigned int min_dist = std::numeric_limits<unsigned int>::max();
   edge* min_p_edge = 0;   // starting from this edge, can backtrack to terminal w/ minimal distance (# of hops)
 
-  for(edge** edge_dptr  = node_i->m_out_edges->scan_first(); edge_dptr; edge_dptr = node_i->m_out_edges->scan_next() ){
-    p_edge = *edge_dptr;
+  for(p_edge = first_out_edge(node_i); p_edge; p_edge = next_out_edge(node_i, p_edge)){
     node_j = p_edge->m_head;
     _Cap cap = (i_is_sink) ? p_edge->m_rcap : p_edge->m_sister->m_rcap;
     // candidate node j must satisfy: 
@@ -240,8 +290,7 @@ void graph<_Cap, _DataChunkSize, _PtrChunkSize>::adopt_orphan(node* node_i)
   else{
     // 1) activate i's neighbors that may claim i as child (positive residual capacity on associated edge)
     // 2) node i's children then become orphans
-    for(edge** edge_dptr  = node_i->m_out_edges->scan_first(); edge_dptr; edge_dptr = node_i->m_out_edges->scan_next() ){
-      p_edge = *edge_dptr;
+    for(p_edge = first_out_edge(node_i); p_edge; p_edge = next_out_edge(node_i, p_edge)){
       node_j = p_edge->m_head;
       if(node_j->is_sink() == i_is_sink && node_j->has_parent()){
         _Cap cap = (i_is_sink) ? p_edge->m_rcap : p_edge->m_sister->m_rcap;
@@ -20,6 +20,10 @@
 
 #include "logismos_chunk_list.hxx"
 #include <queue>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cassert>
 #include <iostream>
 #include <string>
 
@@ -31,22 +35,46 @@ namespace LOGISMOS{
 /// graph nodes or edges, using large value for large graph can improve the performance.
 /// _PtrChunkSize is the size of a chunk used to store pointers to edges associated with
 /// a node, should be similar to the number of such edges.
+/// _Alloc is rebound to allocate all containers of the graph, it has to be default constructible
+/// (e.g. a stateless allocator counting allocations).
+///
+/// Two storage layouts are supported for the adjacency of the nodes:
+/// - chunked (default): every node owns a chunk_list of pointers to its outgoing edges,
+///   edges can be added in any order without knowing their number beforehand;
+/// - packed: the number of edges per node is counted first (count_edge(), allocate_edges())
+///   and all edges are stored in one contiguous arena in CSR order (offset array + edge array),
+///   so the outgoing edges of a node are adjacent in memory and no per-node allocation is required.
+///
+/// After the first solve(), capacities can be changed with update_st_edge() and update_edge() and the
+/// problem can be solved again reusing the flow and the search trees of the previous solution
+/// (dynamic graph cuts, Kohli and Torr), so only the parts of the trees affected by the changes are rebuilt.
+/// Alternatively, reset() removes flow, trees and capacities so the same topology can be solved from scratch
+/// with new capacities without allocating nodes and edges again.
 ///
 /// \author Honghai Zhang
-template <typename _Cap, std::size_t _DataChunkSize=1024, std::size_t _PtrChunkSize=32>
+template <typename _Cap, std::size_t _DataChunkSize=1024, std::size_t _PtrChunkSize=32, typename _Alloc=std::allocator<_Cap> >
 class graph
 {
   struct node;
   struct edge;
   
-  typedef chunk_list<node, _DataChunkSize>  node_cont_type;     ///< for node container
-  typedef chunk_list<edge, _DataChunkSize>  edge_cont_type;     ///< for edge container
-  typedef std::deque<node*>                 node_p_queue_type;  ///< for FIFO of node pointers
-  typedef chunk_list<edge*,_PtrChunkSize>   edge_p_cont_type;   ///< for 'array' of edge pointers
+  typedef std::allocator_traits<_Alloc> alloc_traits;
+  typedef chunk_list<node, _DataChunkSize, typename alloc_traits::template rebind_alloc<node> >   node_cont_type;     ///< for node container
+  typedef chunk_list<edge, _DataChunkSize, typename alloc_traits::template rebind_alloc<edge> >   edge_cont_type;     ///< for edge container
+  typedef std::deque<node*, typename alloc_traits::template rebind_alloc<node*> >                 node_p_queue_type;  ///< for FIFO of node pointers
+  typedef chunk_list<edge*,_PtrChunkSize, typename alloc_traits::template rebind_alloc<edge*> >   edge_p_cont_type;   ///< for 'array' of edge pointers
+  typedef std::vector<edge, typename alloc_traits::template rebind_alloc<edge> >                  edge_arena_type;    ///< for packed edge storage
+  typedef std::vector<std::size_t, typename alloc_traits::template rebind_alloc<std::size_t> >    offset_cont_type;   ///< for edge offsets of packed edge storage
+  typedef std::vector<edge*, typename alloc_traits::template rebind_alloc<edge*> >                edge_p_index_type;  ///< for edge lookup by index of packed edge storage
+  typedef typename alloc_traits::template rebind_alloc<edge_p_cont_type>                          edge_p_cont_alloc_type;
   
   /// \brief Data structure for a graph node
   struct node{
-    edge_p_cont_type* m_out_edges;  ///< outgoing edges, tail=this node
+    union{
+      edge_p_cont_type* m_out_edges;  ///< outgoing edges, tail=this node (chunked storage)
+      edge*             m_first_out;  ///< first outgoing edge in the edge arena (packed storage)
+    };
+    edge*             m_last_out;   ///< position after the last outgoing edge in the edge arena (packed storage)
     edge*             m_par_edge;   ///< parent edge in the search tree. 0: no parent, 1: terminal, 2: orphan
     
     _Cap              m_rcap;       ///< residual capacity, positive for source->node, negative for node->sink
@@ -54,14 +82,8 @@ class graph
     unsigned int      m_time;       ///< a time stamp indicates when m_dist is modified
     unsigned char     m_tag;        ///< several bitwise tags, [na, na, na, na, changed, marked, active, sink]
     
-    /// \brief Constructor, probably will not be called by other member functions of the graph class
-    node() : m_par_edge(0), m_rcap(0), m_dist(0), m_time(0), m_tag(0)
-    { 
-      m_out_edges = new edge_p_cont_type(); 
-    }
-    
-    /// \brief Destructor.
-    ~node(){  delete m_out_edges; m_out_edges = 0;}
+    // note: no constructor or destructor, nodes are stored in chunks that are zero-filled (see chunk_list.hxx)
+    // and the edge containers of chunked storage are released by the destructor of the graph.
     
     // quick ways to determine and set special status of the node and its parent edge.
     
@@ -99,6 +121,14 @@ private:
   node_p_queue_type m_orphan_nodes;   ///< a queue (FIFO) for orphan nodes
   unsigned int      m_clock;          ///< a global clock provides time stamp for all nodes
   _Cap              m_flow;           ///< total flow in the graph
+  
+  bool              m_packed;         ///< true if edges are stored in the packed edge arena instead of the chunks
+  edge_arena_type   m_edge_arena;     ///< all the graph edges, grouped by tail node (packed storage)
+  offset_cont_type  m_edge_offsets;   ///< edge counts per node before allocate_edges(), offsets into m_edge_arena after (packed storage)
+  std::size_t       m_packed_edge_cnt;///< number of edges added to m_edge_arena so far (packed storage)
+  edge_p_index_type m_packed_edges;   ///< forward edge of every edge pair in the order of add_edge() (packed storage)
+  
+  node_p_queue_type m_marked_nodes;   ///< a queue (FIFO) for nodes with changed capacities since the last solve()
 
   /// \brief Set node as active and add it to active node queue.
   inline void activate(node* p_node)
@@ -110,6 +140,69 @@ private:
     } 
   }
   
+  /// \brief Mark node whose terminal or edge capacities changed, its search tree status is validated by next solve(true).
+  inline void mark_node(node* p_node)
+  {
+    if(p_node->is_marked() == false){
+      p_node->set_marked(true);
+      m_marked_nodes.push_back(p_node);
+    }
+  }
+  
+  /// \brief Add given residual capacities to the terminal edges of a node that is already part of a solved graph.
+  ///
+  /// Negative values may only be passed if the corresponding residual capacity covers them.
+  inline void add_terminal_residuals(node* p_node, _Cap s_res, _Cap t_res)
+  {
+    if(p_node->m_rcap > 0)  s_res += p_node->m_rcap;
+    else                    t_res -= p_node->m_rcap;
+    m_flow += (s_res < t_res) ? s_res : t_res;  // push flow directly from source to sink
+    p_node->m_rcap = s_res - t_res;
+    mark_node(p_node);
+  }
+  
+  /// \brief Returns the forward edge of the edge pair with the given index (as returned by add_edge()).
+  inline edge* edge_at(std::size_t e)
+  {
+    assert(e < get_edge_cnt());
+    return (m_packed) ? m_packed_edges[e/2] : m_edges.ptr_at(e);
+  }
+  
+  /// \brief Returns the first outgoing edge of the given node, zero if the node has no outgoing edge.
+  inline edge* first_out_edge(node* p_node)
+  {
+    if(m_packed)  return (p_node->m_first_out != p_node->m_last_out) ? p_node->m_first_out : 0;
+    edge** edge_dptr = p_node->m_out_edges->scan_first();
+    return (edge_dptr) ? *edge_dptr : 0;
+  }
+  
+  /// \brief Returns the outgoing edge following p_edge, zero if all outgoing edges of the node have been visited.
+  ///
+  /// \note Must be preceded by first_out_edge() for the same node.
+  inline edge* next_out_edge(node* p_node, edge* p_edge)
+  {
+    if(m_packed)  return (++p_edge != p_node->m_last_out) ? p_edge : 0;
+    edge** edge_dptr = p_node->m_out_edges->scan_next();
+    return (edge_dptr) ? *edge_dptr : 0;
+  }
+  
+  /// \brief Allocates the container of the outgoing edges of a node (chunked storage).
+  inline edge_p_cont_type* new_out_edges()
+  {
+    edge_p_cont_alloc_type alloc;
+    edge_p_cont_type* p_out_edges = std::allocator_traits<edge_p_cont_alloc_type>::allocate(alloc, 1);
+    std::allocator_traits<edge_p_cont_alloc_type>::construct(alloc, p_out_edges);
+    return p_out_edges;
+  }
+  
+  /// \brief Releases a container allocated by new_out_edges().
+  inline void delete_out_edges(edge_p_cont_type* p_out_edges)
+  {
+    edge_p_cont_alloc_type alloc;
+    std::allocator_traits<edge_p_cont_alloc_type>::destroy(alloc, p_out_edges);
+    std::allocator_traits<edge_p_cont_alloc_type>::deallocate(alloc, p_out_edges, 1);
+  }
+  
   /// \brief Mark given node as orphan and add it to the orphan queue.
   inline void mark_orphan(node* p_node)
   {
@@ -132,26 +225,44 @@ private:
   /// \brief Adopt the orphan node.
   void adopt_orphan(node* node_i);
   
+  /// \brief Restore valid search trees after capacity changes of the marked nodes.
+  ///
+  /// Marked nodes with residual terminal capacity become roots of the respective tree,
+  /// their former children in the other tree and marked nodes without terminal capacity become orphans.
+  void restore_trees();
+  
   /////////////////////////////////////////////////////////
   
 public:
 
   /// \brief Constructor. Create a empty graph
-  graph() : m_clock(0), m_flow(0){  }
+  ///
+  /// \param packed_edges use the packed edge storage, see count_edge() and allocate_edges().
+  explicit graph(bool packed_edges = false) : m_clock(0), m_flow(0), m_packed(packed_edges), m_packed_edge_cnt(0){  }
   
   /// \brief Destructor.
   ~graph(){
-    m_active_nodes.clear(); m_orphan_nodes.clear();
+    m_active_nodes.clear(); m_orphan_nodes.clear(); m_marked_nodes.clear();
+    if(m_packed == false){
+      // chunks never call the destructor of node, so the edge containers are released here
+      for(node* p_node = m_nodes.scan_first(); p_node; p_node = m_nodes.scan_next()){
+        delete_out_edges(p_node->m_out_edges);  p_node->m_out_edges = 0;
+      }
+    }
     m_nodes.clear();        m_edges.clear();
   }
   
+  /// \brief Returns true if the graph uses the packed edge storage.
+  inline bool is_packed(){  return m_packed;  }
+  
   /// \brief Add one nodes to the graph and returns the index of the node added.
   inline std::size_t add_node()
   {
     std::size_t offset = m_nodes.size();
     node* p_node = m_nodes.grow();
     // initialize the new node since m_nodes.grow() will not call the constructor of node
-    p_node->m_out_edges = new edge_p_cont_type(); 
+    if(m_packed)  m_edge_offsets.push_back(0);
+    else          p_node->m_out_edges = new_out_edges(); 
     return offset;
   }
   
@@ -166,10 +277,14 @@ public:
     if(cnt == 1)  return add_node();
     std::size_t offset=m_nodes.size();
     m_nodes.grow(cnt);
+    if(m_packed){ // edges will be counted per node by count_edge()
+      m_edge_offsets.resize(m_nodes.size(), 0);
+      return offset;
+    }
     std::size_t i(0);
     for(node* p_node = m_nodes.scan_start(offset); p_node; p_node = m_nodes.scan_next()){
       // initialize the new node since m_nodes.grow() will not call the constructor of node
-      p_node->m_out_edges = new edge_p_cont_type(); 
+      p_node->m_out_edges = new_out_edges(); 
       i++;
     }
     return offset;
@@ -210,6 +325,44 @@ public:
     return false;
   }
   
+  /// \brief Announce that one edge between node i and node j will be added (packed storage only).
+  ///
+  /// Must be called once for every edge to be added with add_edge(), after all nodes are added
+  /// and before allocate_edges() is called.
+  inline void count_edge(std::size_t i, std::size_t j)
+  {
+    assert(m_packed);
+    assert(i<m_edge_offsets.size() && j<m_edge_offsets.size());
+    m_edge_offsets[i]++;  m_edge_offsets[j]++;
+  }
+  
+  /// \brief Allocate the edge arena for all edges announced by count_edge() (packed storage only).
+  ///
+  /// The counts are converted into offsets and every node gets its (still empty) range of the arena.
+  /// Afterwards, add_edge() fills these ranges; nodes cannot be added anymore.
+  void allocate_edges()
+  {
+    assert(m_packed);
+    assert(m_edge_offsets.size() == m_nodes.size());
+    std::size_t total(0);
+    for(std::size_t i=0;i<m_edge_offsets.size();++i){
+      std::size_t cnt = m_edge_offsets[i];
+      m_edge_offsets[i] = total;
+      total += cnt;
+    }
+    m_edge_offsets.push_back(total);
+    
+    m_edge_arena.assign(total, edge());
+    m_packed_edge_cnt = 0;
+    m_packed_edges.clear();
+    m_packed_edges.reserve(total/2);
+    edge* p_first = m_edge_arena.empty() ? 0 : &(m_edge_arena[0]);
+    std::size_t i(0);
+    for(node* p_node = m_nodes.scan_first(); p_node; p_node = m_nodes.scan_next(), ++i){
+      p_node->m_first_out = p_node->m_last_out = p_first + m_edge_offsets[i];
+    }
+  }
+  
   /// \brief Add a NEW non-terminal edge from node i to node j.
   ///
   /// \param fwd_cap non-negative capacity from i to j.
@@ -219,13 +372,32 @@ public:
   /// the user need to provide proper 'infinity' value for cap.
   /// \note This function ALWAYS add a new edge (i,j) to the graph even if edge (i,j) already exists.
   /// The user is responsible for using this function properly.
+  /// \note For packed storage, the edge must have been announced by count_edge() before allocate_edges().
   inline std::size_t add_edge(std::size_t i, std::size_t j, _Cap fwd_cap, _Cap rev_cap = 0)
   {
-    
-    std::size_t old_size = m_edges.size();
     node* node_i = m_nodes.ptr_at(i);
     node* node_j = m_nodes.ptr_at(j);
     
+    if(m_packed){
+      assert(m_edge_offsets.size() == m_nodes.size()+1);
+      assert(node_i->m_last_out < &(m_edge_arena[0]) + m_edge_offsets[i+1]);
+      assert(node_j->m_last_out < &(m_edge_arena[0]) + m_edge_offsets[j+1]);
+      
+      std::size_t old_size = m_packed_edge_cnt;
+      edge* fwd_edge = node_i->m_last_out++;
+      edge* rev_edge = node_j->m_last_out++;
+      fwd_edge->m_head = node_j;
+      fwd_edge->m_rcap = fwd_cap;
+      fwd_edge->m_sister = rev_edge;
+      rev_edge->m_head = node_i;
+      rev_edge->m_rcap = rev_cap;
+      rev_edge->m_sister = fwd_edge;
+      m_packed_edges.push_back(fwd_edge);
+      m_packed_edge_cnt += 2;
+      return old_size;
+    }
+    
+    std::size_t old_size = m_edges.size();
     edge* fwd_edge = m_edges.grow();
     edge* rev_edge = m_edges.grow();
     fwd_edge->m_head = node_j;
@@ -242,15 +414,115 @@ public:
   }
   
   /// \brief Get total number of non-terminal edges in the graph.
-  inline std::size_t get_edge_cnt(){  return m_edges.size();  }
+  inline std::size_t get_edge_cnt(){  return (m_packed) ? m_packed_edge_cnt : m_edges.size();  }
   
   /// \brief Get the number of non-terminal edges start from node i.
-  inline std::size_t get_outgoing_edge_cnt(std::size_t i){  assert(i<m_nodes.size()); return m_nodes[i].m_out_edges->size();  }
+  inline std::size_t get_outgoing_edge_cnt(std::size_t i)
+  {
+    assert(i<m_nodes.size());
+    node* p_node = m_nodes.ptr_at(i);
+    return (m_packed) ? std::size_t(p_node->m_last_out - p_node->m_first_out) : p_node->m_out_edges->size();
+  }
+  
+  /// \brief Change the capacities of the terminal edges 'source->i' and 'i->sink' of a solved graph by the given amounts.
+  ///
+  /// \param delta_s change of capacity for edge source->i.
+  /// \param delta_t change of capacity for edge i->sink.
+  /// If the flow of a terminal edge exceeds its new capacity, the excess is added to the capacities of both
+  /// terminal edges of the node, which shifts the cost of all cuts by the same amount and keeps the flow valid.
+  /// \note Only valid after solve() was called once, call solve(true) afterwards.
+  inline void update_st_edge(std::size_t i, _Cap delta_s, _Cap delta_t)
+  {
+    assert(i<m_nodes.size());
+    node* p_node = m_nodes.ptr_at(i);
+    _Cap s_res = (p_node->m_rcap > 0) ? p_node->m_rcap : 0;
+    _Cap t_res = (p_node->m_rcap < 0) ? -(p_node->m_rcap) : 0;
+    s_res += delta_s;
+    t_res += delta_t;
+    if(s_res < 0){  t_res -= s_res; m_flow += s_res; s_res = 0; }
+    if(t_res < 0){  s_res -= t_res; m_flow += t_res; t_res = 0; }
+    p_node->m_rcap = 0;
+    add_terminal_residuals(p_node, s_res, t_res);
+  }
+  
+  /// \brief Change the capacities of an edge of a solved graph by the given amounts.
+  ///
+  /// \param e index of the edge as returned by add_edge().
+  /// \param delta_fwd change of capacity from i to j.
+  /// \param delta_rev change of capacity from j to i.
+  /// If the flow on the edge exceeds its new capacity, the excess is rerouted through the terminal edges of both nodes.
+  /// \note Only valid after solve() was called once, call solve(true) afterwards.
+  inline void update_edge(std::size_t e, _Cap delta_fwd, _Cap delta_rev)
+  {
+    edge* fwd_edge = edge_at(e);
+    edge* rev_edge = fwd_edge->m_sister;
+    node* node_i = rev_edge->m_head;
+    node* node_j = fwd_edge->m_head;
+    
+    fwd_edge->m_rcap += delta_fwd;
+    rev_edge->m_rcap += delta_rev;
+    _Cap excess(0);
+    if(fwd_edge->m_rcap < 0){ // flow i->j too large: i keeps the excess, j misses it
+      excess = -(fwd_edge->m_rcap);
+      fwd_edge->m_rcap = 0;
+      rev_edge->m_rcap -= excess;
+      add_terminal_residuals(node_i, excess, 0);
+      add_terminal_residuals(node_j, 0, excess);
+    }
+    else if(rev_edge->m_rcap < 0){  // flow j->i too large: j keeps the excess, i misses it
+      excess = -(rev_edge->m_rcap);
+      rev_edge->m_rcap = 0;
+      fwd_edge->m_rcap -= excess;
+      add_terminal_residuals(node_j, excess, 0);
+      add_terminal_residuals(node_i, 0, excess);
+    }
+    m_flow -= excess;
+    mark_node(node_i);
+    mark_node(node_j);
+  }
+  
+  /// \brief Remove the flow, the search trees and all capacities, but keep the nodes and edges.
+  ///
+  /// Afterwards the graph is in the same state as after adding the nodes and edges with zero capacities:
+  /// terminal capacities are set again with add_st_edge(), edge capacities with set_edge(), followed by solve(false).
+  /// Repeatedly solving graphs with the same topology this way avoids allocating nodes and edges again.
+  void reset()
+  {
+    m_active_nodes.clear(); m_orphan_nodes.clear(); m_marked_nodes.clear();
+    m_clock = 0;
+    m_flow = 0;
+    for(node* p_node = m_nodes.scan_first(); p_node; p_node = m_nodes.scan_next()){
+      p_node->m_par_edge = 0;
+      p_node->m_rcap = 0;
+      p_node->m_dist = 0;
+      p_node->m_time = 0;
+      p_node->m_tag = 0;
+    }
+    if(m_packed){
+      for(std::size_t i=0;i<m_edge_arena.size();++i)  m_edge_arena[i].m_rcap = 0;
+    }
+    else{
+      for(edge* p_edge = m_edges.scan_first(); p_edge; p_edge = m_edges.scan_next())  p_edge->m_rcap = 0;
+    }
+  }
+  
+  /// \brief Set the capacities of an edge after reset().
+  ///
+  /// \param e index of the edge as returned by add_edge().
+  /// \param fwd_cap non-negative capacity from i to j.
+  /// \param rev_cap non-negative capacity from j to i.
+  inline void set_edge(std::size_t e, _Cap fwd_cap, _Cap rev_cap = 0)
+  {
+    edge* fwd_edge = edge_at(e);
+    fwd_edge->m_rcap = fwd_cap;
+    fwd_edge->m_sister->m_rcap = rev_cap;
+  }
   
   /// \brief Solve the maximum-flow/minimum s-t cut problem and returns the maximum flow value.
   ///
-  /// \note Not used for search tree reuse.
-  _Cap solve();
+  /// \param reuse_trees continue from the flow and search trees of the previous solve() after capacities were
+  /// changed by update_st_edge() or update_edge(). Must be false for the first call.
+  _Cap solve(bool reuse_trees = false);
   
   /// \brief Determines if the given node is in the source set of the cut.
   ///
@@ -0,0 +1,462 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+#ifndef _LOGISMOS_implicit_push_relabel_hxx_
+#define _LOGISMOS_implicit_push_relabel_hxx_
+
+#include "logismos_solver.hxx"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+namespace LOGISMOS{
+
+/// \brief Highest-label push-relabel solver engine for OSF column graphs whose non-terminal arcs are never stored.
+///
+/// The graph consists of columns of consecutive nodes and a symmetric neighborhood of the columns. The arcs are the
+/// ones created by the OSF graph builder and are generated on the fly from the column topology:
+/// - intra-column arcs (v,k)->(v,k-1) with infinite capacity,
+/// - hard smoothness arcs (v,k)->(w,max(k-max_diff,0)) with infinite capacity for every neighbor w of v,
+/// - soft smoothness arcs (v,k)<->(w,k) with the soft penalty as capacity in both directions.
+///
+/// Only the flow on the infinite arcs (which is the residual capacity of their reverse arcs) and the residual
+/// capacities of the soft smoothness arcs are stored, no arc heads, sisters or offsets. The algorithm is the same
+/// as in push_relabel (see push_relabel.hxx): the preflow is pushed on the reversed network, so in_source_set()
+/// returns the minimal source set. Like push_relabel, it saturates only residual capacities of exactly zero, so with
+/// floating point capacities the cut may differ from the one of the BK-style graph (the energy of the cuts is the same).
+///
+/// Nodes are added with add_column(), neighborhoods with add_column_neighbor(); add_edge() is not supported.
+template <typename _Cap>
+class implicit_push_relabel : public solver<_Cap>
+{
+  typedef std::vector<std::size_t> index_cont_type;  ///< for node, column and slot indices
+  typedef std::vector<_Cap>        cap_cont_type;    ///< for flows and residual capacities
+
+  /// \brief Data structure for a node
+  struct node{
+    _Cap        m_excess;       ///< excess of the preflow
+    _Cap        m_sink_rcap;    ///< residual capacity of the edge to the sink (of the reversed network)
+    std::size_t m_column;       ///< column of the node
+    std::size_t m_label;        ///< distance label, unreachable_label(): can not reach the sink
+    std::size_t m_current;      ///< current arc, see get_arc()
+    std::size_t m_bucket_next;  ///< next node with the same label
+    std::size_t m_bucket_prev;  ///< previous node with the same label
+    std::size_t m_active_next;  ///< next active node with the same label
+  };
+
+  /// \brief Data structure for a column
+  struct column{
+    std::size_t m_first_node;     ///< index of the node at position 0
+    std::size_t m_size;           ///< number of nodes
+    std::size_t m_first_neighbor; ///< first slot of the neighbors in m_neighbors
+    std::size_t m_neighbor_cnt;   ///< number of neighbors
+    std::size_t m_first_slot;     ///< first entry of the column in m_hard_flow and m_soft_rcap
+  };
+
+  /// \brief An arc of the reversed network as generated by get_arc(), nullptr capacities are infinite.
+  struct arc{
+    std::size_t m_head;         ///< head node
+    _Cap*       m_rcap;         ///< residual capacity of the arc
+    _Cap*       m_sister_rcap;  ///< residual capacity of the reverse arc
+  };
+
+  static const std::size_t m_none = std::numeric_limits<std::size_t>::max();  ///< end of a list
+
+  std::vector<node>   m_nodes;          ///< all nodes
+  std::vector<column> m_columns;        ///< all columns
+  std::vector<index_cont_type> m_column_neighbors; ///< neighbors of each column while adding them
+  index_cont_type     m_neighbors;      ///< neighbor columns of all columns
+  index_cont_type     m_sister_slots;   ///< for each neighbor slot the slot of the column in the neighbor's list
+  cap_cont_type       m_up_flow;        ///< flow on the reversed intra-column arc (v,k)->(v,k+1) of each node
+  cap_cont_type       m_hard_flow;      ///< flow on the reversed hard smoothness arc into each node per neighbor
+  cap_cont_type       m_soft_rcap;      ///< residual capacity of the soft smoothness arc of each node per neighbor
+  index_cont_type     m_bucket_first;   ///< first node of each label
+  index_cont_type     m_active_first;   ///< first active node of each label
+  index_cont_type     m_queue;          ///< queue of the breadth first search of global relabeling
+  const std::size_t   m_max_diff;       ///< hard smoothness constraint, max() for none
+  const _Cap          m_soft_penalty;   ///< capacity of the soft smoothness arcs, 0 for none
+  std::size_t         m_max_column_size;///< number of nodes of the largest column
+  std::size_t         m_arc_cnt;        ///< number of generated arcs, used to schedule global relabeling
+  std::size_t         m_max_label;      ///< highest label with a node, can be an overestimate
+  std::size_t         m_max_active;     ///< highest label with an active node, can be an overestimate
+  std::size_t         m_work;           ///< work since the last global relabeling
+  _Cap                m_flow;           ///< maximum flow
+  bool                m_allocated;      ///< whether allocate_edges() was called
+
+  /// \brief Label of nodes that can not reach the sink, larger than any distance.
+  std::size_t unreachable_label() const{ return m_nodes.size()+1; }
+
+  /// \brief Whether hard smoothness arcs exist.
+  bool has_hard_arcs() const{ return m_max_diff!=std::numeric_limits<std::size_t>::max(); }
+
+  /// \brief Number of reversed hard smoothness arcs leaving a node at position k per neighbor.
+  std::size_t hard_fan(std::size_t k) const{
+    if(!has_hard_arcs()) return 0;
+    return k==0 ? std::min(m_max_diff, m_max_column_size-1)+1 : 1;
+  }
+
+  /// \brief Number of arc indices of node i, some of them may not exist (see get_arc()).
+  std::size_t arc_end(std::size_t i) const{
+    const column& c = m_columns[m_nodes[i].m_column];
+    return 2+c.m_neighbor_cnt*(2+hard_fan(i-c.m_first_node));
+  }
+
+  bool get_arc(std::size_t i, std::size_t a, arc& result);
+
+  /// \brief Pushes delta along the arc.
+  static void push(const arc& a, _Cap delta){
+    if(a.m_rcap!=nullptr) *a.m_rcap -= delta;
+    if(a.m_sister_rcap!=nullptr) *a.m_sister_rcap += delta;
+  }
+
+  /// \brief Add the node to the list of nodes with its label.
+  void bucket_insert(std::size_t i){
+    node& n = m_nodes[i];
+    n.m_bucket_prev = m_none;
+    n.m_bucket_next = m_bucket_first[n.m_label];
+    if(n.m_bucket_next!=m_none) m_nodes[n.m_bucket_next].m_bucket_prev = i;
+    m_bucket_first[n.m_label] = i;
+    if(n.m_label>m_max_label) m_max_label = n.m_label;
+  }
+
+  /// \brief Remove the node from the list of nodes with its label.
+  void bucket_remove(std::size_t i){
+    node& n = m_nodes[i];
+    if(n.m_bucket_prev!=m_none) m_nodes[n.m_bucket_prev].m_bucket_next = n.m_bucket_next;
+    else m_bucket_first[n.m_label] = n.m_bucket_next;
+    if(n.m_bucket_next!=m_none) m_nodes[n.m_bucket_next].m_bucket_prev = n.m_bucket_prev;
+  }
+
+  /// \brief Add the node to the active nodes with its label.
+  void activate(std::size_t i){
+    node& n = m_nodes[i];
+    n.m_active_next = m_active_first[n.m_label];
+    m_active_first[n.m_label] = i;
+    if(n.m_label>m_max_active) m_max_active = n.m_label;
+  }
+
+  void global_relabel();
+  void discharge(std::size_t i);
+  bool relabel(std::size_t i);
+
+public:
+  /// \brief Constructor.
+  ///
+  /// \param max_diff hard smoothness constraint, std::numeric_limits<std::size_t>::max() for none.
+  /// \param soft_penalty capacity of the soft smoothness arcs, 0 for none.
+  implicit_push_relabel(std::size_t max_diff, _Cap soft_penalty) : m_max_diff(max_diff), m_soft_penalty(soft_penalty),
+    m_max_column_size(0), m_arc_cnt(0), m_max_label(0), m_max_active(0), m_work(0), m_flow(0), m_allocated(false){  }
+
+  /// \brief Add a column of cnt nodes and returns the index of the column, its nodes get consecutive indices.
+  std::size_t add_column(std::size_t cnt){
+    assert(!m_allocated);
+    column c = {m_nodes.size(), cnt, 0, 0, 0};
+    m_columns.push_back(c);
+    m_column_neighbors.push_back(index_cont_type());
+    node n = {0, 0, m_columns.size()-1, 0, 0, m_none, m_none, m_none};
+    m_nodes.resize(m_nodes.size()+cnt, n);
+    m_max_column_size = std::max(m_max_column_size, cnt);
+    return m_columns.size()-1;
+  }
+
+  /// \brief Get total number of columns.
+  std::size_t get_column_cnt() const{ return m_columns.size(); }
+
+  /// \brief Add column j as neighbor of column i, the neighborhood has to be symmetric.
+  void add_column_neighbor(std::size_t i, std::size_t j){
+    assert(!m_allocated && i<m_columns.size() && j<m_columns.size() && i!=j);
+    m_column_neighbors[i].push_back(j);
+  }
+
+  /// \brief Not supported, use add_column().
+  std::size_t add_nodes(std::size_t) override{  assert(false); return m_nodes.size(); }
+
+  /// \brief Get total number of nodes.
+  std::size_t get_node_cnt() override{  return m_nodes.size(); }
+
+  /// \brief Add terminal edges 'source->i' and 'i->sink' with given capacities.
+  ///
+  /// In the reversed network the sink pushes t_cap into the node and the node can push s_cap to the source,
+  /// the common part of both is sent directly.
+  bool add_st_edge(std::size_t i, _Cap s_cap, _Cap t_cap) override{
+    if(i>=m_nodes.size()) return false;
+    node& n = m_nodes[i];
+    n.m_excess += t_cap;
+    n.m_sink_rcap += s_cap;
+    _Cap direct = std::min(n.m_excess, n.m_sink_rcap);
+    n.m_excess -= direct;
+    n.m_sink_rcap -= direct;
+    m_flow += direct;
+    return true;
+  }
+
+  /// \brief Build the neighbor slots and allocate the flows and residual capacities of all implicit arcs.
+  void allocate_edges() override;
+
+  /// \brief Not supported, all non-terminal arcs are implicit.
+  std::size_t add_edge(std::size_t, std::size_t, _Cap, _Cap) override{  assert(false); return 0; }
+
+  /// \brief Solve the maximum-flow/minimum s-t cut problem and returns the maximum flow value.
+  _Cap solve() override;
+
+  /// \brief Determines if the given node is in the source set of the cut.
+  bool in_source_set(std::size_t i) override{ return m_nodes[i].m_label<unreachable_label(); }
+};  // end of class implicit_push_relabel
+
+template <typename _Cap>
+const std::size_t implicit_push_relabel<_Cap>::m_none;
+
+template <typename _Cap>
+void implicit_push_relabel<_Cap>::allocate_edges()
+{
+  assert(!m_allocated);
+  std::size_t slot_cnt = 0;
+  for(std::size_t c=0; c<m_columns.size(); ++c){
+    column& col = m_columns[c];
+    col.m_first_neighbor = m_neighbors.size();
+    col.m_neighbor_cnt = m_column_neighbors[c].size();
+    col.m_first_slot = slot_cnt;
+    slot_cnt += col.m_size*col.m_neighbor_cnt;
+    m_neighbors.insert(m_neighbors.end(), m_column_neighbors[c].begin(), m_column_neighbors[c].end());
+  }
+  m_column_neighbors.clear();
+  m_column_neighbors.shrink_to_fit();
+
+  m_sister_slots.assign(m_neighbors.size(), m_none);
+  for(std::size_t c=0; c<m_columns.size(); ++c){
+    const column& col = m_columns[c];
+    for(std::size_t j=0; j<col.m_neighbor_cnt; ++j){
+      const column& nb = m_columns[m_neighbors[col.m_first_neighbor+j]];
+      for(std::size_t s=0; s<nb.m_neighbor_cnt; ++s)
+        if(m_neighbors[nb.m_first_neighbor+s]==c) m_sister_slots[col.m_first_neighbor+j] = s;
+      assert(m_sister_slots[col.m_first_neighbor+j]!=m_none);
+    }
+  }
+
+  m_up_flow.assign(m_nodes.size(), 0);
+  if(has_hard_arcs()) m_hard_flow.assign(slot_cnt, 0);
+  if(m_soft_penalty>0) m_soft_rcap.assign(slot_cnt, m_soft_penalty);
+  m_arc_cnt = 0;
+  for(std::size_t i=0; i<m_nodes.size(); ++i) m_arc_cnt += arc_end(i);
+  m_allocated = true;
+}
+
+/// \brief Generates arc a of node i in the reversed network, returns false if the arc does not exist.
+///
+/// The arcs of a node at position k of column v with neighbors w_j are, in this order:
+/// - 0: (v,k)->(v,k+1), reversed intra-column arc, infinite
+/// - 1: (v,k)->(v,k-1), reverse of the reversed intra-column arc into (v,k)
+/// - 2+2j: (v,k)->(w_j,k), soft smoothness arc
+/// - 3+2j: (v,k)->(w_j,max(k-max_diff,0)), reverse of the reversed hard smoothness arc into (v,k)
+/// - 2+2*deg+j*fan+m: (v,k)->(w_j,k'), reversed hard smoothness arcs, infinite; k'=k+max_diff for k>0 and
+///   k'=m for k=0 (all positions within max_diff of the bottom map to position 0)
+template <typename _Cap>
+bool implicit_push_relabel<_Cap>::get_arc(std::size_t i, std::size_t a, arc& result)
+{
+  const column& col = m_columns[m_nodes[i].m_column];
+  const std::size_t k = i-col.m_first_node;
+  const std::size_t deg = col.m_neighbor_cnt;
+  if(a==0){
+    if(k+1>=col.m_size) return false;
+    result.m_head = i+1;  result.m_rcap = nullptr;  result.m_sister_rcap = &m_up_flow[i];
+    return true;
+  }
+  if(a==1){
+    if(k==0) return false;
+    result.m_head = i-1;  result.m_rcap = &m_up_flow[i-1];  result.m_sister_rcap = nullptr;
+    return true;
+  }
+  a -= 2;
+  if(a<2*deg){
+    const std::size_t j = a/2;
+    const column& nb = m_columns[m_neighbors[col.m_first_neighbor+j]];
+    if(a%2==0){
+      if(m_soft_penalty<=0 || k>=nb.m_size) return false;
+      result.m_head = nb.m_first_node+k;
+      result.m_rcap = &m_soft_rcap[col.m_first_slot+k*deg+j];
+      result.m_sister_rcap = &m_soft_rcap[nb.m_first_slot+k*nb.m_neighbor_cnt+m_sister_slots[col.m_first_neighbor+j]];
+      return true;
+    }
+    if(!has_hard_arcs()) return false;
+    const std::size_t target = k>m_max_diff ? k-m_max_diff : 0;
+    if(target>=nb.m_size) return false;
+    result.m_head = nb.m_first_node+target;
+    result.m_rcap = &m_hard_flow[col.m_first_slot+k*deg+j];
+    result.m_sister_rcap = nullptr;
+    return true;
+  }
+  a -= 2*deg;
+  const std::size_t fan = hard_fan(k);
+  const std::size_t j = a/fan;
+  const column& nb = m_columns[m_neighbors[col.m_first_neighbor+j]];
+  const std::size_t source = k==0 ? a%fan : k+m_max_diff;
+  if(source>=nb.m_size) return false;
+  result.m_head = nb.m_first_node+source;
+  result.m_rcap = nullptr;
+  result.m_sister_rcap = &m_hard_flow[nb.m_first_slot+source*nb.m_neighbor_cnt+m_sister_slots[col.m_first_neighbor+j]];
+  return true;
+}
+
+/// \brief Computes the exact distance labels to the sink by a breadth first search on the residual graph and
+/// rebuilds the lists of nodes and active nodes.
+template <typename _Cap>
+void implicit_push_relabel<_Cap>::global_relabel()
+{
+  const std::size_t n_cnt = m_nodes.size();
+  const std::size_t unreachable = unreachable_label();
+  std::fill(m_bucket_first.begin(), m_bucket_first.end(), m_none);
+  std::fill(m_active_first.begin(), m_active_first.end(), m_none);
+  m_max_label = 0;
+  m_max_active = 0;
+  m_work = 0;
+
+  m_queue.clear();
+  for(std::size_t i=0; i<n_cnt; ++i){
+    node& n = m_nodes[i];
+    n.m_current = 0;
+    if(n.m_sink_rcap>0){
+      n.m_label = 1;
+      m_queue.push_back(i);
+    }
+    else n.m_label = unreachable;
+  }
+  arc ar;
+  for(std::size_t q=0; q<m_queue.size(); ++q){
+    std::size_t i = m_queue[q];
+    std::size_t label = m_nodes[i].m_label+1;
+    std::size_t end = arc_end(i);
+    for(std::size_t a=0; a<end; ++a){
+      if(!get_arc(i, a, ar)) continue;
+      std::size_t j = ar.m_head;
+      if(m_nodes[j].m_label==unreachable && (ar.m_sister_rcap==nullptr || *ar.m_sister_rcap>0)){
+        m_nodes[j].m_label = label;
+        m_queue.push_back(j);
+      }
+    }
+  }
+  for(std::size_t q=0; q<m_queue.size(); ++q){
+    std::size_t i = m_queue[q];
+    bucket_insert(i);
+    if(m_nodes[i].m_excess>0) activate(i);
+  }
+}
+
+/// \brief Relabels node i after all its admissible arcs are saturated, returns false if a gap appeared or
+/// the node can not reach the sink anymore.
+template <typename _Cap>
+bool implicit_push_relabel<_Cap>::relabel(std::size_t i)
+{
+  const std::size_t unreachable = unreachable_label();
+  node& n = m_nodes[i];
+  std::size_t old_label = n.m_label;
+  bucket_remove(i);
+
+  if(m_bucket_first[old_label]==m_none){
+    // gap: no node above the old label can reach the sink anymore
+    for(std::size_t label=old_label+1; label<=m_max_label; ++label){
+      for(std::size_t j=m_bucket_first[label]; j!=m_none; j=m_nodes[j].m_bucket_next)
+        m_nodes[j].m_label = unreachable;
+      m_bucket_first[label] = m_none;
+      m_active_first[label] = m_none;
+    }
+    n.m_label = unreachable;
+    m_max_label = old_label-1;
+    return false;
+  }
+
+  std::size_t new_label = unreachable;
+  std::size_t end = arc_end(i);
+  arc ar;
+  for(std::size_t a=0; a<end; ++a){
+    if(get_arc(i, a, ar) && (ar.m_rcap==nullptr || *ar.m_rcap>0) && m_nodes[ar.m_head].m_label+1<new_label){
+      new_label = m_nodes[ar.m_head].m_label+1;
+      n.m_current = a;
+    }
+  }
+  m_work += end+12;
+  n.m_label = new_label;
+  if(new_label>=unreachable) return false;
+  bucket_insert(i);
+  return true;
+}
+
+/// \brief Pushes the excess of node i to its neighbors (and the sink) until it is empty or the node is inactive.
+template <typename _Cap>
+void implicit_push_relabel<_Cap>::discharge(std::size_t i)
+{
+  node& n = m_nodes[i];
+  arc ar;
+  for(;;){
+    if(n.m_label==1 && n.m_sink_rcap>0){
+      _Cap delta = std::min(n.m_excess, n.m_sink_rcap);
+      n.m_sink_rcap -= delta;
+      n.m_excess -= delta;
+      m_flow += delta;
+      if(n.m_excess==0) return;
+    }
+
+    std::size_t target_label = n.m_label-1;
+    std::size_t end = arc_end(i);
+    for(std::size_t a=n.m_current; a<end; ++a){
+      if(!get_arc(i, a, ar) || (ar.m_rcap!=nullptr && *ar.m_rcap<=0)) continue;
+      node& nj = m_nodes[ar.m_head];
+      if(nj.m_label!=target_label) continue;
+      _Cap delta = ar.m_rcap==nullptr ? n.m_excess : std::min(n.m_excess, *ar.m_rcap);
+      push(ar, delta);
+      if(nj.m_excess==0) activate(ar.m_head);
+      nj.m_excess += delta;
+      n.m_excess -= delta;
+      if(n.m_excess==0){
+        n.m_current = a;
+        return;
+      }
+    }
+
+    if(!relabel(i)) return;
+  }
+}
+
+template <typename _Cap>
+_Cap implicit_push_relabel<_Cap>::solve()
+{
+  const std::size_t n_cnt = m_nodes.size();
+  if(!m_allocated) allocate_edges();
+  m_bucket_first.assign(n_cnt+2, m_none);
+  m_active_first.assign(n_cnt+2, m_none);
+  const std::size_t global_relabel_work = 6*n_cnt+m_arc_cnt/2;
+
+  global_relabel();
+  for(;;){
+    while(m_max_active>0 && m_active_first[m_max_active]==m_none) --m_max_active;
+    if(m_max_active==0) break;
+
+    std::size_t i = m_active_first[m_max_active];
+    m_active_first[m_max_active] = m_nodes[i].m_active_next;
+    discharge(i);
+
+    if(m_work>global_relabel_work) global_relabel();
+  }
+
+  // the final labels tell which nodes can reach the sink of the reversed network
+  global_relabel();
+  return m_flow;
+}
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,395 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+#ifndef _LOGISMOS_pseudoflow_hxx_
+#define _LOGISMOS_pseudoflow_hxx_
+
+#include "logismos_solver.hxx"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+namespace LOGISMOS{
+
+/// \brief Hochbaum's pseudoflow solver engine (HPF), lowest label variant with FIFO buckets.
+///
+/// Source and sink edges are saturated initially, every node starts as a tree of its own which is strong if it
+/// has excess and weak otherwise. The excess of strong trees is pushed along merger arcs into weak trees, trees
+/// are split where an arc saturates. Only the first phase (minimum cut) is computed. An arc is saturated only if its
+/// residual capacity is exactly zero, unlike graph::augment_path, so with floating point capacities the cut may differ
+/// from the one of the BK-style graph where residuals are close to zero (the energy of the cuts is the same).
+template <typename _Cap>
+class pseudoflow : public solver<_Cap>
+{
+  static const std::size_t m_none = std::numeric_limits<std::size_t>::max();  ///< no node/arc, end of a list
+
+  /// \brief Data structure for an arc, flow is in [0, m_cap]
+  struct arc{
+    std::size_t   m_from;       ///< tail node
+    std::size_t   m_to;         ///< head node
+    _Cap          m_flow;       ///< flow
+    _Cap          m_cap;        ///< capacity
+  };
+
+  /// \brief Data structure for a node
+  struct node{
+    _Cap        m_excess;         ///< excess, only roots of trees have non-zero excess
+    _Cap        m_terminal;       ///< capacity of the source edge minus capacity of the sink edge
+    std::size_t m_label;          ///< distance label
+    std::size_t m_parent;         ///< parent in the tree, m_none for roots
+    std::size_t m_arc_to_parent;  ///< arc connecting the node to its parent
+    std::size_t m_first_child;    ///< first child in the tree
+    std::size_t m_next_sibling;   ///< next child of the parent
+    std::size_t m_prev_sibling;   ///< previous child of the parent
+    std::size_t m_next_scan;      ///< next child to scan
+    std::size_t m_next_root;      ///< next root in the same strong bucket
+    std::size_t m_out_begin;      ///< first entry of the out-of-tree arcs in m_out_of_tree
+    std::size_t m_out_cnt;        ///< number of out-of-tree arcs
+    std::size_t m_next_arc;       ///< first out-of-tree arc not yet scanned with the current label
+  };
+
+  std::vector<node>        m_nodes;          ///< all nodes
+  std::vector<arc>         m_arcs;           ///< all arcs
+  std::vector<std::size_t> m_out_of_tree;    ///< out-of-tree arcs with residual capacity leaving each node
+  std::vector<std::size_t> m_label_cnt;      ///< number of nodes with each label
+  std::vector<std::size_t> m_bucket_first;   ///< first strong root of each label
+  std::vector<std::size_t> m_bucket_last;    ///< last strong root of each label
+  std::size_t              m_lowest_label;   ///< lowest label of a strong root, can be an underestimate
+  std::size_t              m_edge_cnt;       ///< number of edges added
+  _Cap                     m_flow;           ///< maximum flow
+  _Cap                     m_terminal_flow;  ///< flow sent directly from source to sink through single nodes
+  bool                     m_allocated;      ///< whether allocate_edges() was called
+
+  /// \brief Add the root to the end of the strong bucket of its label.
+  void add_strong_root(std::size_t i){
+    node& n = m_nodes[i];
+    n.m_next_root = m_none;
+    if(m_bucket_first[n.m_label]==m_none) m_bucket_first[n.m_label] = i;
+    else m_nodes[m_bucket_last[n.m_label]].m_next_root = i;
+    m_bucket_last[n.m_label] = i;
+    if(n.m_label<m_lowest_label) m_lowest_label = n.m_label;
+  }
+
+  /// \brief Make child a child of parent using the given arc.
+  void add_child(std::size_t parent, std::size_t child, std::size_t a){
+    node& c = m_nodes[child];
+    node& p = m_nodes[parent];
+    c.m_parent = parent;
+    c.m_arc_to_parent = a;
+    c.m_prev_sibling = m_none;
+    c.m_next_sibling = p.m_first_child;
+    if(p.m_first_child!=m_none) m_nodes[p.m_first_child].m_prev_sibling = child;
+    p.m_first_child = child;
+  }
+
+  /// \brief Remove child from the children of its parent.
+  void remove_child(std::size_t child){
+    node& c = m_nodes[child];
+    if(c.m_prev_sibling!=m_none) m_nodes[c.m_prev_sibling].m_next_sibling = c.m_next_sibling;
+    else m_nodes[c.m_parent].m_first_child = c.m_next_sibling;
+    if(c.m_next_sibling!=m_none) m_nodes[c.m_next_sibling].m_prev_sibling = c.m_prev_sibling;
+    c.m_parent = m_none;
+  }
+
+  /// \brief Add an arc to the out-of-tree arcs of node i.
+  void add_out_of_tree(std::size_t i, std::size_t a){
+    node& n = m_nodes[i];
+    m_out_of_tree[n.m_out_begin+n.m_out_cnt++] = a;
+  }
+
+  /// \brief Increase the label of node i by one.
+  void relabel(std::size_t i){
+    node& n = m_nodes[i];
+    --m_label_cnt[n.m_label];
+    ++m_label_cnt[++n.m_label];
+    n.m_next_arc = 0;
+  }
+
+  std::size_t get_lowest_strong_root();
+  std::size_t find_weak_node(std::size_t i, std::size_t label, std::size_t& weak_node);
+  void check_children(std::size_t i);
+  void merge(std::size_t parent, std::size_t child, std::size_t a);
+  void push_excess(std::size_t strong_root);
+  void process_root(std::size_t strong_root);
+
+public:
+  /// \brief Constructor.
+  pseudoflow() : m_lowest_label(0), m_edge_cnt(0), m_flow(0), m_terminal_flow(0), m_allocated(false){  }
+
+  /// \brief Add cnt nodes and returns the index of the first node added.
+  std::size_t add_nodes(std::size_t cnt) override{
+    assert(!m_allocated);
+    std::size_t first = m_nodes.size();
+    node n = {0, 0, 0, m_none, m_none, m_none, m_none, m_none, m_none, m_none, 0, 0, 0};
+    m_nodes.resize(first+cnt, n);
+    return first;
+  }
+
+  /// \brief Get total number of nodes.
+  std::size_t get_node_cnt() override{  return m_nodes.size(); }
+
+  /// \brief Add terminal edges 'source->i' and 'i->sink' with given capacities, both are saturated.
+  bool add_st_edge(std::size_t i, _Cap s_cap, _Cap t_cap) override{
+    if(i>=m_nodes.size()) return false;
+    m_nodes[i].m_terminal += s_cap-t_cap;
+    m_terminal_flow += std::min(s_cap, t_cap);
+    return true;
+  }
+
+  /// \brief All edges have to be counted.
+  bool counts_edges() override{ return true; }
+
+  /// \brief Announce that one edge between node i and node j will be added.
+  void count_edge(std::size_t i, std::size_t j) override{
+    assert(!m_allocated && i<m_nodes.size() && j<m_nodes.size());
+    // both directions can become an arc, each arc can be out of tree at either end
+    m_nodes[i].m_out_cnt += 2;
+    m_nodes[j].m_out_cnt += 2;
+  }
+
+  /// \brief Allocate the memory for all edges announced by count_edge().
+  void allocate_edges() override{
+    assert(!m_allocated);
+    std::size_t offset = 0;
+    for(std::size_t i=0; i<m_nodes.size(); ++i){
+      m_nodes[i].m_out_begin = offset;
+      offset += m_nodes[i].m_out_cnt;
+      m_nodes[i].m_out_cnt = 0;
+    }
+    m_out_of_tree.resize(offset);
+    m_arcs.reserve(offset/2);
+    m_allocated = true;
+  }
+
+  /// \brief Add a non-terminal edge from node i to node j and returns its index.
+  ///
+  /// Every direction with non-zero capacity is stored as a separate arc.
+  std::size_t add_edge(std::size_t i, std::size_t j, _Cap fwd_cap, _Cap rev_cap) override{
+    assert(m_allocated && i<m_nodes.size() && j<m_nodes.size());
+    if(fwd_cap>0){
+      arc a = {i, j, 0, fwd_cap};
+      add_out_of_tree(i, m_arcs.size());
+      m_arcs.push_back(a);
+    }
+    if(rev_cap>0){
+      arc a = {j, i, 0, rev_cap};
+      add_out_of_tree(j, m_arcs.size());
+      m_arcs.push_back(a);
+    }
+    return 2*(m_edge_cnt++);
+  }
+
+  /// \brief Solve the maximum-flow/minimum s-t cut problem and returns the maximum flow value.
+  _Cap solve() override;
+
+  /// \brief Determines if the given node is in the source set of the cut.
+  bool in_source_set(std::size_t i) override{ return m_nodes[i].m_label>=m_lowest_label; }
+};  // end of class pseudoflow
+
+template <typename _Cap>
+const std::size_t pseudoflow<_Cap>::m_none;
+
+/// \brief Returns the strong root with the lowest label, or m_none if no strong root can be merged anymore.
+template <typename _Cap>
+std::size_t pseudoflow<_Cap>::get_lowest_strong_root()
+{
+  const std::size_t max_label = m_nodes.size()+1;
+  for(std::size_t label=m_lowest_label; label<max_label; ++label){
+    if(m_bucket_first[label]!=m_none){
+      m_lowest_label = label;
+      // gap: no weak node can be reached from strong nodes anymore
+      if(m_label_cnt[label-1]==0) return m_none;
+      std::size_t i = m_bucket_first[label];
+      m_bucket_first[label] = m_nodes[i].m_next_root;
+      m_nodes[i].m_next_root = m_none;
+      return i;
+    }
+  }
+  m_lowest_label = max_label;
+  return m_none;
+}
+
+/// \brief Finds an out-of-tree arc with residual capacity from node i to a node with the given label.
+///
+/// The arc is removed from the out-of-tree arcs and returned, m_none if there is none.
+template <typename _Cap>
+std::size_t pseudoflow<_Cap>::find_weak_node(std::size_t i, std::size_t label, std::size_t& weak_node)
+{
+  node& n = m_nodes[i];
+  std::size_t* out = &m_out_of_tree[n.m_out_begin];
+  for(std::size_t k=n.m_next_arc; k<n.m_out_cnt; ++k){
+    const arc& a = m_arcs[out[k]];
+    std::size_t other = a.m_from==i ? a.m_to : a.m_from;
+    if(m_nodes[other].m_label==label){
+      n.m_next_arc = k;
+      std::size_t found = out[k];
+      out[k] = out[--n.m_out_cnt];
+      weak_node = other;
+      return found;
+    }
+  }
+  n.m_next_arc = n.m_out_cnt;
+  return m_none;
+}
+
+/// \brief Continues scanning the children of node i, relabels the node if no child has the same label.
+template <typename _Cap>
+void pseudoflow<_Cap>::check_children(std::size_t i)
+{
+  node& n = m_nodes[i];
+  for( ; n.m_next_scan!=m_none; n.m_next_scan = m_nodes[n.m_next_scan].m_next_sibling){
+    if(m_nodes[n.m_next_scan].m_label==n.m_label) return;
+  }
+  relabel(i);
+}
+
+/// \brief Hangs the tree of child below parent using arc a, child becomes the root of its former tree first.
+template <typename _Cap>
+void pseudoflow<_Cap>::merge(std::size_t parent, std::size_t child, std::size_t a)
+{
+  std::size_t current = child;
+  std::size_t new_parent = parent;
+  std::size_t new_arc = a;
+  while(m_nodes[current].m_parent!=m_none){
+    std::size_t old_parent = m_nodes[current].m_parent;
+    std::size_t old_arc = m_nodes[current].m_arc_to_parent;
+    remove_child(current);
+    add_child(new_parent, current, new_arc);
+    new_parent = current;
+    current = old_parent;
+    new_arc = old_arc;
+  }
+  add_child(new_parent, current, new_arc);
+}
+
+/// \brief Pushes the excess of the strong root towards the root of its tree, splits the tree at saturated arcs.
+template <typename _Cap>
+void pseudoflow<_Cap>::push_excess(std::size_t strong_root)
+{
+  std::size_t current = strong_root;
+  _Cap prev_excess = 1;
+  while(m_nodes[current].m_excess>0 && m_nodes[current].m_parent!=m_none){
+    node& c = m_nodes[current];
+    std::size_t parent = c.m_parent;
+    node& p = m_nodes[parent];
+    arc& a = m_arcs[c.m_arc_to_parent];
+    prev_excess = p.m_excess;
+
+    // residual capacity from the child to the parent
+    bool upward = a.m_from==current;
+    _Cap rcap = upward ? a.m_cap-a.m_flow : a.m_flow;
+    if(rcap>=c.m_excess){
+      if(upward) a.m_flow += c.m_excess;
+      else a.m_flow -= c.m_excess;
+      p.m_excess += c.m_excess;
+      c.m_excess = 0;
+    }
+    else{
+      // arc saturates: split, the child keeps the remaining excess as a new strong root
+      a.m_flow = upward ? a.m_cap : 0;
+      p.m_excess += rcap;
+      c.m_excess -= rcap;
+      add_out_of_tree(parent, c.m_arc_to_parent);
+      remove_child(current);
+      add_strong_root(current);
+    }
+    current = parent;
+  }
+  if(m_nodes[current].m_excess>0 && prev_excess<=0) add_strong_root(current);
+}
+
+/// \brief Searches the strong tree for a merger arc in depth first order, relabels the nodes without one.
+template <typename _Cap>
+void pseudoflow<_Cap>::process_root(std::size_t strong_root)
+{
+  const std::size_t weak_label = m_lowest_label-1;
+  std::size_t strong_node = strong_root;
+  std::size_t weak_node = m_none;
+  std::size_t a = m_none;
+
+  m_nodes[strong_root].m_next_scan = m_nodes[strong_root].m_first_child;
+  if((a = find_weak_node(strong_root, weak_label, weak_node))!=m_none){
+    merge(weak_node, strong_root, a);
+    push_excess(strong_root);
+    return;
+  }
+  check_children(strong_root);
+  while(strong_node!=m_none){
+    while(m_nodes[strong_node].m_next_scan!=m_none){
+      std::size_t next = m_nodes[strong_node].m_next_scan;
+      m_nodes[strong_node].m_next_scan = m_nodes[next].m_next_sibling;
+      strong_node = next;
+      m_nodes[strong_node].m_next_scan = m_nodes[strong_node].m_first_child;
+      if((a = find_weak_node(strong_node, weak_label, weak_node))!=m_none){
+        merge(weak_node, strong_node, a);
+        push_excess(strong_root);
+        return;
+      }
+      check_children(strong_node);
+    }
+    if((strong_node = m_nodes[strong_node].m_parent)!=m_none) check_children(strong_node);
+  }
+  add_strong_root(strong_root);
+}
+
+template <typename _Cap>
+_Cap pseudoflow<_Cap>::solve()
+{
+  const std::size_t n_cnt = m_nodes.size();
+  if(!m_allocated) allocate_edges();
+  m_label_cnt.assign(n_cnt+2, 0);
+  m_bucket_first.assign(n_cnt+2, m_none);
+  m_bucket_last.assign(n_cnt+2, m_none);
+
+  // simple initialization: terminal edges saturated, all non-terminal arcs empty, strong nodes start with label 1
+  m_lowest_label = 1;
+  m_label_cnt[0] = n_cnt;
+  for(std::size_t i=0; i<n_cnt; ++i){
+    node& n = m_nodes[i];
+    n.m_excess = n.m_terminal;
+    if(n.m_excess>0){
+      relabel(i);
+      add_strong_root(i);
+    }
+  }
+
+  std::size_t strong_root;
+  while((strong_root = get_lowest_strong_root())!=m_none)
+    process_root(strong_root);
+
+  // flow value is the capacity of the cut
+  m_flow = m_terminal_flow;
+  for(std::size_t i=0; i<n_cnt; ++i){
+    const node& n = m_nodes[i];
+    if(in_source_set(i)){
+      if(n.m_terminal<0) m_flow -= n.m_terminal;
+    }
+    else{
+      if(n.m_terminal>0) m_flow += n.m_terminal;
+    }
+  }
+  for(std::size_t k=0; k<m_arcs.size(); ++k){
+    const arc& a = m_arcs[k];
+    if(in_source_set(a.m_from) && !in_source_set(a.m_to)) m_flow += a.m_cap;
+  }
+  return m_flow;
+}
+
+} // end of namespace
+
+#endif
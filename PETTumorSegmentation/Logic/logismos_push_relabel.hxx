@@ -0,0 +1,333 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+#ifndef _LOGISMOS_push_relabel_hxx_
+#define _LOGISMOS_push_relabel_hxx_
+
+#include "logismos_solver.hxx"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+namespace LOGISMOS{
+
+/// \brief Highest-label push-relabel solver engine with global relabeling and gap heuristic (Goldberg and Tarjan,
+/// Cherkassky and Goldberg).
+///
+/// Only the first phase (maximum preflow) is computed. The preflow is pushed on the reversed network (source and
+/// sink swapped, all edges reversed): the nodes that can still reach the sink of the reversed network are exactly
+/// the nodes reachable from the source in the residual graph of the original network, so in_source_set() returns
+/// the minimal source set like the BK-style graph (see solver for floating point capacities).
+///
+/// All edges are stored in one contiguous arena in CSR order, so they have to be announced with count_edge() and
+/// allocated with allocate_edges() before they are added.
+template <typename _Cap>
+class push_relabel : public solver<_Cap>
+{
+  typedef std::vector<std::size_t> index_cont_type;  ///< for node and arc indices
+  typedef std::vector<_Cap>        cap_cont_type;    ///< for residual capacities
+
+  /// \brief Data structure for a node
+  struct node{
+    _Cap        m_excess;       ///< excess of the preflow
+    _Cap        m_sink_rcap;    ///< residual capacity of the edge to the sink (of the reversed network)
+    std::size_t m_label;        ///< distance label, unreachable_label(): can not reach the sink
+    std::size_t m_current;      ///< current arc
+    std::size_t m_bucket_next;  ///< next node with the same label
+    std::size_t m_bucket_prev;  ///< previous node with the same label
+    std::size_t m_active_next;  ///< next active node with the same label
+  };
+
+  static const std::size_t m_none = std::numeric_limits<std::size_t>::max();  ///< end of a list
+
+  std::vector<node> m_nodes;        ///< all nodes
+  index_cont_type   m_arc_offsets;  ///< number of arcs per node before allocate_edges(), first arc of each node after
+  index_cont_type   m_arc_head;     ///< head node of each arc
+  index_cont_type   m_arc_sister;   ///< reverse arc of each arc
+  cap_cont_type     m_arc_rcap;     ///< residual capacity of each arc
+  index_cont_type   m_arc_fill;     ///< next free arc of each node while adding edges
+  index_cont_type   m_bucket_first; ///< first node of each label
+  index_cont_type   m_active_first; ///< first active node of each label
+  index_cont_type   m_queue;        ///< queue of the breadth first search of global relabeling
+  std::size_t       m_edge_cnt;     ///< number of edges added
+  std::size_t       m_max_label;    ///< highest label with a node, can be an overestimate
+  std::size_t       m_max_active;   ///< highest label with an active node, can be an overestimate
+  std::size_t       m_work;         ///< work since the last global relabeling
+  _Cap              m_flow;         ///< maximum flow
+  bool              m_allocated;    ///< whether allocate_edges() was called
+
+  /// \brief Label of nodes that can not reach the sink, larger than any distance.
+  std::size_t unreachable_label() const{ return m_nodes.size()+1; }
+
+  /// \brief Add the node to the list of nodes with its label.
+  void bucket_insert(std::size_t i){
+    node& n = m_nodes[i];
+    n.m_bucket_prev = m_none;
+    n.m_bucket_next = m_bucket_first[n.m_label];
+    if(n.m_bucket_next!=m_none) m_nodes[n.m_bucket_next].m_bucket_prev = i;
+    m_bucket_first[n.m_label] = i;
+    if(n.m_label>m_max_label) m_max_label = n.m_label;
+  }
+
+  /// \brief Remove the node from the list of nodes with its label.
+  void bucket_remove(std::size_t i){
+    node& n = m_nodes[i];
+    if(n.m_bucket_prev!=m_none) m_nodes[n.m_bucket_prev].m_bucket_next = n.m_bucket_next;
+    else m_bucket_first[n.m_label] = n.m_bucket_next;
+    if(n.m_bucket_next!=m_none) m_nodes[n.m_bucket_next].m_bucket_prev = n.m_bucket_prev;
+  }
+
+  /// \brief Add the node to the active nodes with its label.
+  void activate(std::size_t i){
+    node& n = m_nodes[i];
+    n.m_active_next = m_active_first[n.m_label];
+    m_active_first[n.m_label] = i;
+    if(n.m_label>m_max_active) m_max_active = n.m_label;
+  }
+
+  void global_relabel();
+  void discharge(std::size_t i);
+  bool relabel(std::size_t i);
+
+public:
+  /// \brief Constructor.
+  push_relabel() : m_edge_cnt(0), m_max_label(0), m_max_active(0), m_work(0), m_flow(0), m_allocated(false){  }
+
+  /// \brief Add cnt nodes and returns the index of the first node added.
+  std::size_t add_nodes(std::size_t cnt) override{
+    assert(!m_allocated);
+    std::size_t first = m_nodes.size();
+    node n = {0, 0, 0, 0, m_none, m_none, m_none};
+    m_nodes.resize(first+cnt, n);
+    m_arc_offsets.resize(first+cnt, 0);
+    return first;
+  }
+
+  /// \brief Get total number of nodes.
+  std::size_t get_node_cnt() override{  return m_nodes.size(); }
+
+  /// \brief Add terminal edges 'source->i' and 'i->sink' with given capacities.
+  ///
+  /// In the reversed network the sink pushes t_cap into the node and the node can push s_cap to the source,
+  /// the common part of both is sent directly.
+  bool add_st_edge(std::size_t i, _Cap s_cap, _Cap t_cap) override{
+    if(i>=m_nodes.size()) return false;
+    node& n = m_nodes[i];
+    n.m_excess += t_cap;
+    n.m_sink_rcap += s_cap;
+    _Cap direct = std::min(n.m_excess, n.m_sink_rcap);
+    n.m_excess -= direct;
+    n.m_sink_rcap -= direct;
+    m_flow += direct;
+    return true;
+  }
+
+  /// \brief All edges have to be counted.
+  bool counts_edges() override{ return true; }
+
+  /// \brief Announce that one edge between node i and node j will be added.
+  void count_edge(std::size_t i, std::size_t j) override{
+    assert(!m_allocated && i<m_nodes.size() && j<m_nodes.size());
+    m_arc_offsets[i]++;
+    m_arc_offsets[j]++;
+  }
+
+  /// \brief Allocate the memory for all edges announced by count_edge().
+  void allocate_edges() override{
+    assert(!m_allocated);
+    std::size_t offset = 0;
+    m_arc_fill.resize(m_nodes.size());
+    for(std::size_t i=0; i<m_nodes.size(); ++i){
+      std::size_t cnt = m_arc_offsets[i];
+      m_arc_offsets[i] = offset;
+      m_arc_fill[i] = offset;
+      offset += cnt;
+    }
+    m_arc_offsets.push_back(offset);
+    m_arc_head.resize(offset);
+    m_arc_sister.resize(offset);
+    m_arc_rcap.resize(offset);
+    m_allocated = true;
+  }
+
+  /// \brief Add a non-terminal edge from node i to node j and returns its index.
+  std::size_t add_edge(std::size_t i, std::size_t j, _Cap fwd_cap, _Cap rev_cap) override{
+    assert(m_allocated && i<m_nodes.size() && j<m_nodes.size());
+    std::size_t a = m_arc_fill[j]++;  // reversed edge j->i with capacity of i->j
+    std::size_t b = m_arc_fill[i]++;  // reversed edge i->j with capacity of j->i
+    assert(a<m_arc_offsets[j+1] && b<m_arc_offsets[i+1]);
+    m_arc_head[a] = i;  m_arc_sister[a] = b;  m_arc_rcap[a] = fwd_cap;
+    m_arc_head[b] = j;  m_arc_sister[b] = a;  m_arc_rcap[b] = rev_cap;
+    return 2*(m_edge_cnt++);
+  }
+
+  /// \brief Solve the maximum-flow/minimum s-t cut problem and returns the maximum flow value.
+  _Cap solve() override;
+
+  /// \brief Determines if the given node is in the source set of the cut.
+  bool in_source_set(std::size_t i) override{ return m_nodes[i].m_label<unreachable_label(); }
+};  // end of class push_relabel
+
+template <typename _Cap>
+const std::size_t push_relabel<_Cap>::m_none;
+
+/// \brief Computes the exact distance labels to the sink by a breadth first search on the residual graph and
+/// rebuilds the lists of nodes and active nodes.
+template <typename _Cap>
+void push_relabel<_Cap>::global_relabel()
+{
+  const std::size_t n_cnt = m_nodes.size();
+  const std::size_t unreachable = unreachable_label();
+  std::fill(m_bucket_first.begin(), m_bucket_first.end(), m_none);
+  std::fill(m_active_first.begin(), m_active_first.end(), m_none);
+  m_max_label = 0;
+  m_max_active = 0;
+  m_work = 0;
+
+  m_queue.clear();
+  for(std::size_t i=0; i<n_cnt; ++i){
+    node& n = m_nodes[i];
+    n.m_current = m_arc_offsets[i];
+    if(n.m_sink_rcap>0){
+      n.m_label = 1;
+      m_queue.push_back(i);
+    }
+    else n.m_label = unreachable;
+  }
+  for(std::size_t q=0; q<m_queue.size(); ++q){
+    std::size_t i = m_queue[q];
+    std::size_t label = m_nodes[i].m_label+1;
+    for(std::size_t a=m_arc_offsets[i]; a<m_arc_offsets[i+1]; ++a){
+      std::size_t j = m_arc_head[a];
+      if(m_nodes[j].m_label==unreachable && m_arc_rcap[m_arc_sister[a]]>0){
+        m_nodes[j].m_label = label;
+        m_queue.push_back(j);
+      }
+    }
+  }
+  for(std::size_t q=0; q<m_queue.size(); ++q){
+    std::size_t i = m_queue[q];
+    bucket_insert(i);
+    if(m_nodes[i].m_excess>0) activate(i);
+  }
+}
+
+/// \brief Relabels node i after all its admissible arcs are saturated, returns false if a gap appeared or
+/// the node can not reach the sink anymore.
+template <typename _Cap>
+bool push_relabel<_Cap>::relabel(std::size_t i)
+{
+  const std::size_t unreachable = unreachable_label();
+  node& n = m_nodes[i];
+  std::size_t old_label = n.m_label;
+  bucket_remove(i);
+
+  if(m_bucket_first[old_label]==m_none){
+    // gap: no node above the old label can reach the sink anymore
+    for(std::size_t label=old_label+1; label<=m_max_label; ++label){
+      for(std::size_t j=m_bucket_first[label]; j!=m_none; j=m_nodes[j].m_bucket_next)
+        m_nodes[j].m_label = unreachable;
+      m_bucket_first[label] = m_none;
+      m_active_first[label] = m_none;
+    }
+    n.m_label = unreachable;
+    m_max_label = old_label-1;
+    return false;
+  }
+
+  std::size_t new_label = unreachable;
+  for(std::size_t a=m_arc_offsets[i]; a<m_arc_offsets[i+1]; ++a){
+    if(m_arc_rcap[a]>0 && m_nodes[m_arc_head[a]].m_label+1<new_label){
+      new_label = m_nodes[m_arc_head[a]].m_label+1;
+      n.m_current = a;
+    }
+  }
+  m_work += m_arc_offsets[i+1]-m_arc_offsets[i]+12;
+  n.m_label = new_label;
+  if(new_label>=unreachable) return false;
+  bucket_insert(i);
+  return true;
+}
+
+/// \brief Pushes the excess of node i to its neighbors (and the sink) until it is empty or the node is inactive.
+template <typename _Cap>
+void push_relabel<_Cap>::discharge(std::size_t i)
+{
+  node& n = m_nodes[i];
+  for(;;){
+    if(n.m_label==1 && n.m_sink_rcap>0){
+      _Cap delta = std::min(n.m_excess, n.m_sink_rcap);
+      n.m_sink_rcap -= delta;
+      n.m_excess -= delta;
+      m_flow += delta;
+      if(n.m_excess==0) return;
+    }
+
+    std::size_t target_label = n.m_label-1;
+    std::size_t end = m_arc_offsets[i+1];
+    for(std::size_t a=n.m_current; a<end; ++a){
+      if(m_arc_rcap[a]>0){
+        std::size_t j = m_arc_head[a];
+        node& nj = m_nodes[j];
+        if(nj.m_label!=target_label) continue;
+        _Cap delta = std::min(n.m_excess, m_arc_rcap[a]);
+        m_arc_rcap[a] -= delta;
+        m_arc_rcap[m_arc_sister[a]] += delta;
+        if(nj.m_excess==0) activate(j);
+        nj.m_excess += delta;
+        n.m_excess -= delta;
+        if(n.m_excess==0){
+          n.m_current = a;
+          return;
+        }
+      }
+    }
+
+    if(!relabel(i)) return;
+  }
+}
+
+template <typename _Cap>
+_Cap push_relabel<_Cap>::solve()
+{
+  const std::size_t n_cnt = m_nodes.size();
+  if(!m_allocated) allocate_edges();
+  m_bucket_first.assign(n_cnt+2, m_none);
+  m_active_first.assign(n_cnt+2, m_none);
+  const std::size_t global_relabel_work = 6*n_cnt+m_arc_head.size()/2;
+
+  global_relabel();
+  for(;;){
+    while(m_max_active>0 && m_active_first[m_max_active]==m_none) --m_max_active;
+    if(m_max_active==0) break;
+
+    std::size_t i = m_active_first[m_max_active];
+    m_active_first[m_max_active] = m_nodes[i].m_active_next;
+    discharge(i);
+
+    if(m_work>global_relabel_work) global_relabel();
+  }
+
+  // the final labels tell which nodes can reach the sink of the reversed network
+  global_relabel();
+  return m_flow;
+}
+
+} // end of namespace
+
+#endif
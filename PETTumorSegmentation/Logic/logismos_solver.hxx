@@ -0,0 +1,125 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+#ifndef _LOGISMOS_solver_hxx_
+#define _LOGISMOS_solver_hxx_
+
+#include "logismos_graph.hxx"
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+namespace LOGISMOS{
+
+/// \brief Abstract interface of a maximum-flow/minimum s-t cut engine.
+///
+/// Nodes are identified by consecutive indices starting at zero, edges by the index returned by add_edge().
+/// in_source_set() returns true exactly for the nodes that can be reached from the source in the residual graph of a
+/// maximum flow (the minimal source set). With floating point capacities the engines may still return different cuts
+/// of the same energy, since graph (BK) treats residual capacities below epsilon as saturated and the others don't.
+template <typename _Cap>
+class solver
+{
+public:
+  /// \brief Destructor.
+  virtual ~solver(){  }
+
+  /// \brief Add cnt nodes and returns the index of the first node added.
+  virtual std::size_t add_nodes(std::size_t cnt) = 0;
+
+  /// \brief Get total number of nodes.
+  virtual std::size_t get_node_cnt() = 0;
+
+  /// \brief Add terminal edges 'source->i' and 'i->sink' with given capacities.
+  virtual bool add_st_edge(std::size_t i, _Cap s_cap, _Cap t_cap) = 0;
+
+  /// \brief Returns true if every edge has to be announced by count_edge() before allocate_edges() and add_edge().
+  virtual bool counts_edges(){  return false; }
+
+  /// \brief Announce that one edge between node i and node j will be added.
+  virtual void count_edge(std::size_t, std::size_t){  }
+
+  /// \brief Allocate the memory for all edges announced by count_edge().
+  virtual void allocate_edges(){  }
+
+  /// \brief Add a non-terminal edge from node i to node j and returns its index.
+  virtual std::size_t add_edge(std::size_t i, std::size_t j, _Cap fwd_cap, _Cap rev_cap) = 0;
+
+  /// \brief Solve the maximum-flow/minimum s-t cut problem and returns the maximum flow value.
+  virtual _Cap solve() = 0;
+
+  /// \brief Determines if the given node is in the source set of the cut.
+  virtual bool in_source_set(std::size_t i) = 0;
+
+  /// \brief Returns true if capacities of a solved graph can be changed and solved again with resolve().
+  virtual bool supports_reuse(){  return false; }
+
+  /// \brief Change the capacities of the terminal edges of node i by the given amounts (only if supports_reuse()).
+  virtual void update_st_edge(std::size_t, _Cap, _Cap){  assert(false);  }
+
+  /// \brief Change the capacities of edge e by the given amounts (only if supports_reuse()).
+  virtual void update_edge(std::size_t, _Cap, _Cap){  assert(false);  }
+
+  /// \brief Solve again after capacity updates, continuing from the previous solution (only if supports_reuse()).
+  virtual _Cap resolve(){ assert(false); return 0; }
+
+  /// \brief Returns true if flow and capacities can be removed with reset() while keeping nodes and edges.
+  virtual bool supports_reset(){  return false; }
+
+  /// \brief Remove flow and all capacities, set them again with add_st_edge() and set_edge() (only if supports_reset()).
+  virtual void reset(){ assert(false);  }
+
+  /// \brief Set the capacities of edge e after reset() (only if supports_reset()).
+  virtual void set_edge(std::size_t, _Cap, _Cap){ assert(false);  }
+};  // end of class solver
+
+/// \brief Solver engine using the BK-style graph (see graph.hxx), supports reuse of search trees and reset.
+///
+/// _Alloc is passed to the graph, which allocates all its containers with it.
+template <typename _Cap, typename _Alloc = std::allocator<_Cap> >
+class bk_solver : public solver<_Cap>
+{
+private:
+  graph<_Cap, 1024, 32, _Alloc> m_graph;  ///< the max flow graph
+
+public:
+  /// \brief Constructor.
+  ///
+  /// \param packed_edges use the packed edge storage of the graph.
+  explicit bk_solver(bool packed_edges = false) : m_graph(packed_edges){  }
+
+  std::size_t add_nodes(std::size_t cnt) override{  return m_graph.add_nodes(cnt); }
+  std::size_t get_node_cnt() override{  return m_graph.get_node_cnt(); }
+  bool add_st_edge(std::size_t i, _Cap s_cap, _Cap t_cap) override{ return m_graph.add_st_edge(i, s_cap, t_cap); }
+  bool counts_edges() override{ return m_graph.is_packed();  }
+  void count_edge(std::size_t i, std::size_t j) override{ if(m_graph.is_packed()) m_graph.count_edge(i, j); }
+  void allocate_edges() override{ if(m_graph.is_packed()) m_graph.allocate_edges(); }
+  std::size_t add_edge(std::size_t i, std::size_t j, _Cap fwd_cap, _Cap rev_cap) override{  return m_graph.add_edge(i, j, fwd_cap, rev_cap); }
+  _Cap solve() override{  return m_graph.solve(false); }
+  bool in_source_set(std::size_t i) override{ return m_graph.in_source_set(i); }
+  bool supports_reuse() override{ return true; }
+  void update_st_edge(std::size_t i, _Cap delta_s, _Cap delta_t) override{ m_graph.update_st_edge(i, delta_s, delta_t); }
+  void update_edge(std::size_t e, _Cap delta_fwd, _Cap delta_rev) override{  m_graph.update_edge(e, delta_fwd, delta_rev); }
+  _Cap resolve() override{  return m_graph.solve(true);  }
+  bool supports_reset() override{ return true; }
+  void reset() override{  m_graph.reset(); }
+  void set_edge(std::size_t e, _Cap fwd_cap, _Cap rev_cap) override{ m_graph.set_edge(e, fwd_cap, rev_cap); }
+};  // end of class bk_solver
+
+} // end of namespace
+
+#endif
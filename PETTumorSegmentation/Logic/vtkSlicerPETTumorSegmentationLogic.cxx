@@ -54,7 +54,6 @@
 // ITK includes
 #include <itkResampleImageFilter.h>
 #include <itkRegularSphereMeshSource.h>
-#include <itkTriangleMeshToBinaryImageFilter.h>
 #include <itkImageDuplicator.h>
 #include <itkImageRegionIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
@@ -62,14 +61,12 @@
 #include <itkConstNeighborhoodIterator.h>
 #include <itkImageFileWriter.h>
 #include <itkMeshFileWriter.h>
-#include <itkConnectedThresholdImageFilter.h>
 #include <itkTimeProbe.h>
 #include <itkMedianImageFilter.h>
 
 // Optimal Surface Finding includes
 #include "itkMeshToOSFGraphFilter.h"
 #include "itkLOGISMOSOSFGraphSolverFilter.h"
-#include "itkOSFGraphToMeshFilter.h"
 #include "itkCloneOSFGraphFilter.h"
 #include "itkCenterNormalColumnBuilderFilter.h"
 #include "itkSimpleOSFGraphBuilderFilter.h"
@@ -79,7 +76,14 @@
 // STD includes
 #include <cassert>
 #include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <queue>
+#include <tuple>
+#include <utility>
 
 #include <qSlicerApplication.h>
 
@@ -111,16 +115,24 @@ void vtkSlicerPETTumorSegmentationLogic::Apply(vtkMRMLPETTumorSegmentationParame
   //If from a click, there will be a new finger print.  If not, update the finger print.
   if (!this->CheckFingerPrint(node))
   { this->UpdateFingerPrint(node);  }
+  LabelRuns_saved.clear(); //The initial label map is obtained anew for every segmentation.
+  LabelCosts_saved.Clear();
 
   //Try to initialize graph with standard costs.  It fails if there's no center point or if the center point is misplaced (off the PET volume).
   bool initializeSuccess = InitializeOSFSegmentation(node, petVolume, initialLabelMap);
   if (initializeSuccess)
   {
+    node->ClearThresholdSweep(); //The graph was recreated, so any cached threshold sweep is outdated.
     UpdateGraphCostsGlobally(node, petVolume, initialLabelMap); //Reapply global refinement, in case apply is from button.  If from click, then there won't be a point anyway.
+    node->ClearCostHistory(); //The global update set the new base costs.
+    OSFGraphType::Pointer baseGraph = node->GetOSFGraph();
+    node->SetOSFGraph( Clone(baseGraph) );
     UpdateGraphCostsLocally(node, petVolume, true); //Reapply all local refinement, in case apply is from button.  If from click, then there aren't any points anyway.
+    RecordCostHistory(node, baseGraph);
 
     //Create the segmentation and apply it to the label map.
     FinalizeOSFSegmentation(node, petVolume, initialLabelMap);
+    ReleaseRefinedCosts(node, baseGraph);
   }
   vtkDebugMacro(;node->WriteTXT("seg_final.txt"));
 }
@@ -141,9 +153,15 @@ void vtkSlicerPETTumorSegmentationLogic::ApplyGlobalRefinement(vtkMRMLPETTumorSe
 
   node->SetOSFGraph( Clone(node->GetOSFGraph()) ); // we manipulate graph costs directly; therefore, we need to clone the initial graph to ensure correct undo/redo behavior
   UpdateGraphCostsGlobally(node, petVolume, initialLabelMap); //Sets the cost for all nodes by threshold.  New threshold is determined inside.
+  node->ClearCostHistory(); //The global update set the new base costs.
+  OSFGraphType::Pointer baseGraph = node->GetOSFGraph();
 
+  node->SetOSFGraph( Clone(baseGraph) );
   UpdateGraphCostsLocally(node, petVolume, true); //Reapplies all local refinement, since older points' effects are lost when global update changes base cost.
-  FinalizeOSFSegmentation(node, petVolume, initialLabelMap);  //Applies the changed label map
+  RecordCostHistory(node, baseGraph);
+  bool solved = LookupThresholdSweep(node); //Uses the cached solution for the new threshold, if there is one.
+  FinalizeOSFSegmentation(node, petVolume, initialLabelMap, !solved);  //Applies the changed label map
+  ReleaseRefinedCosts(node, baseGraph); //The node keeps the base costs, the refined costs are replayed from the cost history.
 
   vtkDebugMacro(;node->WriteTXT("global_refinement_final.txt"));
 }
@@ -162,13 +180,113 @@ void vtkSlicerPETTumorSegmentationLogic::ApplyLocalRefinement(vtkMRMLPETTumorSeg
     initialLabelMap = resampleNN<LabelImageType,ScalarImageType>(node->GetInitialLabelMap(), petVolume);
   vtkDebugMacro(;node->WriteTXT("local_refinement_init.txt"));
 
-  node->SetOSFGraph( Clone(node->GetOSFGraph()) ); // we manipulate graph costs directly; therefore, we need to clone the initial graph to ensure correct undo/redo behavior
+  OSFGraphType::Pointer baseGraph = node->GetOSFGraph();
+  OSFGraphType::Pointer refinedGraph = ReplayCostHistory(node); //Restores the costs of all previous refinement steps.
+  if (node->GetCostHistory() && node->GetCostHistory()==SolvedCostHistory_saved)
+    refinedGraph->GetSurface()->ClearDirtyColumns(); //These are the costs of the most recent solution, so only the columns of the new point have to be rebuilt.
+  node->SetOSFGraph( Clone(refinedGraph) ); // we manipulate graph costs directly; therefore, we need to clone the refined graph to record the changes
+  node->ClearThresholdSweep(); //The sweep does not include the new refinement point.
   UpdateGraphCostsLocally(node, petVolume); //Add effect of most recent refinement point only
+  RecordCostHistory(node, refinedGraph);
 
   FinalizeOSFSegmentation(node, petVolume, initialLabelMap);  //Applies the changed label map
+  ReleaseRefinedCosts(node, baseGraph); //The node keeps the base costs, the refined costs are replayed from the cost history.
   vtkDebugMacro(;node->WriteTXT("local_refinement_final.txt"));
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::ComputeThresholdSweep(vtkMRMLPETTumorSegmentationParametersNode* node, vtkImageData* labelImageData, int numberOfThresholds)
+{
+  if (!ValidInput(node) || node->GetOSFGraph().IsNull() || numberOfThresholds<1)  //check for validity and graph existence
+    return;
+  vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepPointer cachedSweep = node->GetThresholdSweep();
+  if (cachedSweep && cachedSweep->Thresholds.size()==size_t(numberOfThresholds) && cachedSweep->SettingsKey==GetThresholdSweepSettingsKey(node))
+    return; //The cached sweep is still valid.
+
+  // the cost function is only meaningful for thresholds between the background level and the uptake at the center
+  float lowerThreshold = node->GetHistogramMedian();
+  float upperThreshold = node->GetCenterpointUptake();
+  if (upperThreshold<=lowerThreshold)
+    return;
+
+  ScalarImageType::Pointer petVolume = GetPETVolume(node);  //convert pet volume to ITK for processing
+  LabelImageType::Pointer initialLabelMap(nullptr);
+  if (labelImageData!=nullptr) // for use with Segmentation Editor
+    initialLabelMap = ConvertLabelImageToITK(node, labelImageData);
+  else // for use with Segment Editor
+    initialLabelMap = resampleNN<LabelImageType,ScalarImageType>(node->GetInitialLabelMap(), petVolume);
+
+  // the cost of a node is not monotone in the threshold (cost above the threshold falls, linear cost below it rises), so the
+  // minimum cuts are not guaranteed to be nested; instead the thresholds are solved in ascending order and every solve
+  // continues from the flow of the previous one, so each step only repairs the part of the cut that moved
+  OSFGraphType::Pointer originalGraph = node->GetOSFGraph();
+  float originalThreshold = node->GetThreshold();
+  node->SetOSFGraph( Clone(originalGraph) );
+
+  std::shared_ptr<vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepType> sweep =
+    std::make_shared<vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepType>();
+  sweep->SettingsKey = GetThresholdSweepSettingsKey(node);
+  for (int i=0; i<numberOfThresholds; ++i)
+  {
+    float threshold = lowerThreshold + (upperThreshold-lowerThreshold)*float(i+1)/float(numberOfThresholds+1);
+    node->SetThreshold(threshold);
+    SetGraphCostsForThreshold(node, petVolume, initialLabelMap);
+    UpdateGraphCostsLocally(node, petVolume, true);
+    MaxFlow(node); // replaces the graph of the node by the solved graph, which is modified in the next iteration
+
+    OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+    std::vector<unsigned int> positions(surface->GetNumberOfVertices());
+    for (size_t vertexId=0; vertexId<positions.size(); ++vertexId)
+      positions[vertexId] = surface->GetCurrentVertexPositionIdentifier(vertexId);
+    sweep->Thresholds.push_back(threshold);
+    sweep->Surfaces.push_back(positions);
+  }
+
+  node->SetOSFGraph(originalGraph);
+  node->SetThreshold(originalThreshold);
+  node->SetThresholdSweep(sweep);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerPETTumorSegmentationLogic::ApplyThresholdSweep(vtkMRMLPETTumorSegmentationParametersNode* node, vtkImageData* labelImageData, float threshold)
+{
+  if (!ValidInput(node) || node->GetOSFGraph().IsNull())  //check for validity and graph existence
+    return false;
+  ComputeThresholdSweep(node, labelImageData); //The sweep is computed on first use and reused while the settings don't change.
+  vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepPointer sweep = node->GetThresholdSweep();
+  if (!sweep || sweep->Thresholds.empty() || sweep->SettingsKey!=GetThresholdSweepSettingsKey(node))
+    return false;
+
+  ScalarImageType::Pointer petVolume = GetPETVolume(node);  //convert pet volume to ITK for processing
+  LabelImageType::Pointer initialLabelMap(nullptr);
+  if (labelImageData!=nullptr) // for use with Segmentation Editor
+    initialLabelMap = ConvertLabelImageToITK(node, labelImageData);
+  else // for use with Segment Editor
+    initialLabelMap = resampleNN<LabelImageType,ScalarImageType>(node->GetInitialLabelMap(), petVolume);
+
+  // snap to the closest threshold of the sweep
+  size_t sweepId = GetClosestThresholdSweepIndex(*sweep, threshold);
+  node->SetThreshold(sweep->Thresholds[sweepId]);
+
+  // the costs are still updated, so later refinements start from the graph of this threshold
+  node->SetOSFGraph( Clone(node->GetOSFGraph()) ); // we manipulate graph costs directly; therefore, we need to clone the initial graph to ensure correct undo/redo behavior
+  SetGraphCostsForThreshold(node, petVolume, initialLabelMap);
+  node->ClearCostHistory();
+  OSFGraphType::Pointer baseGraph = node->GetOSFGraph();
+  node->SetOSFGraph( Clone(baseGraph) );
+  UpdateGraphCostsLocally(node, petVolume, true);
+  RecordCostHistory(node, baseGraph);
+
+  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+  const std::vector<unsigned int>& positions = sweep->Surfaces[sweepId];
+  for (size_t vertexId=0; vertexId<positions.size(); ++vertexId)
+    surface->SetCurrentVertexPositionIdentifier(vertexId, positions[vertexId]);
+
+  FinalizeOSFSegmentation(node, petVolume, initialLabelMap, false);
+  ReleaseRefinedCosts(node, baseGraph);
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkSlicerPETTumorSegmentationLogic::LabelImageType::Pointer vtkSlicerPETTumorSegmentationLogic::ConvertLabelImageToITK(vtkMRMLPETTumorSegmentationParametersNode* node, vtkImageData* labelImageData)
 {
@@ -274,16 +392,17 @@ bool vtkSlicerPETTumorSegmentationLogic::InitializeOSFSegmentation(vtkMRMLPETTum
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::FinalizeOSFSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap)
+void vtkSlicerPETTumorSegmentationLogic::FinalizeOSFSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap, bool solve)
 {
   //Run the maximum flow algorithm
-  MaxFlow(node);
-
-  //Get the resulting boundary it determined
-  MeshType::Pointer segmentationMesh = GetSegmentationMesh(node);
+  if (solve)
+  {
+    MaxFlow(node);
+    SolvedCostHistory_saved = node->GetCostHistory(); //The costs were recorded before, so the next local refinement can start from this solution.
+  }
 
-  //Voxelize that boundary
-  LabelImageType::Pointer segmentation = GetSegmentation(node, segmentationMesh, initialLabelMap);
+  //Voxelize the resulting boundary
+  LabelImageType::Pointer segmentation = GetSegmentation(node, initialLabelMap);
 
   //Integrate that segmentation with the existing segmentation
   UpdateOutput(node, petVolume, segmentation, initialLabelMap);
@@ -302,22 +421,11 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateGraphCostsGlobally(vtkMRMLPETTumo
   if (globalRefinementFiducials->GetNumberOfControlPoints()==0)
     CalculateThresholdHistogramBased(node, petVolume);
   else //Otherwise, get it by the point
+  {
     CalculateThresholdPointLocationBased(node, petVolume);
+  }
 
-  //Create the interpolators for the volumes here to avoid instantiating new ones for every thread.
-  InterpolatorType::Pointer interpolator = InterpolatorType::New();
-  interpolator->SetInputImage( petVolume );
-  LabelInterpolatorType::Pointer labelInterpolator = LabelInterpolatorType::New();
-  labelInterpolator->SetInputImage( initialLabelMap );
-  WatershedInterpolatorType::Pointer strongWatershedInterpolator = WatershedInterpolatorType::New();
-  strongWatershedInterpolator->SetInputImage( GetStrongWatershedVolume(node, petVolume) );
-  WatershedInterpolatorType::Pointer weakWatershedInterpolator = WatershedInterpolatorType::New();
-  weakWatershedInterpolator->SetInputImage( GetWeakWatershedVolume(node, petVolume) );
-
-  //Multithreaded graph cost setting.
-  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
-  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*, InterpolatorType::Pointer, LabelInterpolatorType::Pointer, WatershedInterpolatorType::Pointer, WatershedInterpolatorType::Pointer>
-    (&SetGlobalGraphCostsForVertex, 0, numVertices-1, node, interpolator, labelInterpolator, strongWatershedInterpolator, weakWatershedInterpolator);
+  SetGraphCostsForThreshold(node, petVolume, initialLabelMap);
 
   //If there's a global refinement point, apply the specific cost effect of it on the relevant column (cost +1000 to all nodes on the column but closest node to point)
   if (globalRefinementFiducials->GetNumberOfControlPoints()!=0)
@@ -326,7 +434,7 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateGraphCostsGlobally(vtkMRMLPETTumo
     PointType refinementPoint = convert2ITK( globalRefinementFiducials->GetNthControlPointPosition(globalRefinementFiducials->GetNumberOfControlPoints()-1) );
     int vertexId = GetClosestVertex(node, refinementPoint);
     int columnId = GetClosestColumnOnVertex(node, refinementPoint, vertexId);
-    std::vector<float>& costs = graph->GetSurface()->GetColumnCosts(vertexId)->CastToSTLContainer();
+    OSFSurfaceType::ColumnCostsSpan costs = graph->GetSurface()->GetWritableColumnCostsSpan(vertexId);
     for (size_t i=0; i<costs.size(); i++)
       costs[i]+=1000;
     costs[columnId]-=1000;
@@ -334,22 +442,123 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateGraphCostsGlobally(vtkMRMLPETTumo
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::SetGlobalGraphCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, InterpolatorType::Pointer interpolator, LabelInterpolatorType::Pointer labelInterpolator, WatershedInterpolatorType::Pointer strongWatershedInterpolator, WatershedInterpolatorType::Pointer weakWatershedInterpolator)
+void vtkSlicerPETTumorSegmentationLogic::SetGraphCostsForThreshold(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap)
 {
-  //Determine and store the uptake values on the nodes, since they are used very frequently.  Cuts down on interpolator access.
-  const std::vector<float> uptakeValues = SampleColumnPoints<float, InterpolatorType>(vertexId, node, interpolator);
+  OSFGraphType::Pointer graph = node->GetOSFGraph();
+  if (petVolume.IsNull() || initialLabelMap.IsNull() || graph.IsNull())
+    return;
+
+  //Get the volumes sampled on all columns.  They are only interpolated once per graph; later cost updates reuse the samples.
+  CostStageInputsType inputs;
+  inputs.Node = node;
+  inputs.UptakeSamples = &GetUptakeSamples(node, petVolume);
+  inputs.LabelRuns = &GetLabelRuns(node, initialLabelMap);
+  if (node->GetSplitting()) //The watersheds are only needed for splitting.
+  {
+    inputs.StrongWatershedSamples = &GetStrongWatershedSamples(node, petVolume);
+    inputs.WeakWatershedSamples = &GetWeakWatershedSamples(node, petVolume);
+  }
 
-  SetGlobalBaseGraphCostsForVertex(vertexId, node, uptakeValues); //Set the costs based on the threshold, as well as the standard rejection
-  if (!node->GetPaintOver())
-    AddLabelAvoidanceCostsForVertex(vertexId, node, uptakeValues, labelInterpolator); //Adds the costs to reject other objects
-  else if (node->GetNecroticRegion())
-    AddDefaultNecroticCostsForVertex(vertexId, node, labelInterpolator);  //Adds the costs for necrotic mode, if it is active and label avoidance is not
-  if (node->GetSplitting())
-    AddSplittingCostsForVertex(vertexId, node, uptakeValues, strongWatershedInterpolator, weakWatershedInterpolator); //Adds the costs for splitting, if active
+  //The mode flags are only checked here; the cost stages are specialized for them.
+  SetGraphCostsForModeFlags(inputs, node->GetPaintOver(), node->GetNecroticRegion(), node->GetSplitting(), node->GetLinearCost());
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::SetGlobalBaseGraphCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, const std::vector<float>& uptakeValues)
+template <bool... modeFlags, typename... remainingModeFlagTypes>
+void vtkSlicerPETTumorSegmentationLogic::SetGraphCostsForModeFlags(const CostStageInputsType& inputs, bool modeFlag, remainingModeFlagTypes... remainingModeFlags)
+{
+  if (modeFlag)
+    SetGraphCostsForModeFlags<modeFlags..., true>(inputs, remainingModeFlags...);
+  else
+    SetGraphCostsForModeFlags<modeFlags..., false>(inputs, remainingModeFlags...);
+}
+
+//----------------------------------------------------------------------------
+template <bool... modeFlags>
+void vtkSlicerPETTumorSegmentationLogic::SetGraphCostsForModeFlags(const CostStageInputsType& inputs)
+{
+  SetGraphCostsForMode< CostModePolicy<modeFlags...> >(inputs);
+}
+
+//----------------------------------------------------------------------------
+template <class ModePolicy>
+void vtkSlicerPETTumorSegmentationLogic::SetGraphCostsForMode(const CostStageInputsType& inputs)
+{
+  //The base costs of all columns are set in one batch.
+  vtkMRMLPETTumorSegmentationParametersNode* node = inputs.Node;
+  SetGlobalBaseGraphCosts<ModePolicy>(node, *inputs.UptakeSamples);
+
+  //The label costs are added from the local copy, which is only recalculated if they depend on a changed setting.
+  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+  int numVertices = surface->GetNumberOfVertices();
+  if (!ModePolicy::PaintOver || ModePolicy::NecroticRegion)
+  {
+    const ColumnSamplesType<float>& labelCosts = GetLabelCosts<ModePolicy>(inputs);
+    for (int vertexId=0; vertexId<numVertices; vertexId++)
+    {
+      ColumnSamplesSpan<float> columnLabelCosts = labelCosts.GetColumn(vertexId);
+      OSFSurfaceType::ColumnCostsSpan costs = surface->GetWritableColumnCostsSpan( vertexId );
+      for (size_t i=0; i<costs.size(); i++)
+        costs[i] += columnLabelCosts[i];
+    }
+  }
+
+  //Multithreaded splitting cost adjustments.
+  if (ModePolicy::Splitting)
+  {
+    itk::Workers().RunFunctionForRange<int, const CostStageInputsType*>
+      (&SetGlobalGraphCostsForVertex<ModePolicy>, 0, numVertices-1, &inputs);
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class ModePolicy>
+const vtkSlicerPETTumorSegmentationLogic::ColumnSamplesType<float>& vtkSlicerPETTumorSegmentationLogic::GetLabelCosts(const CostStageInputsType& inputs)
+{
+  //The label costs depend on the label, the modes and the lower bound of the uptake, but not on the threshold,
+  //except for label avoidance in necrotic mode, which only searches beyond the node where the uptake rises above the threshold.
+  vtkMRMLPETTumorSegmentationParametersNode* node = inputs.Node;
+  std::vector<float> labelCostsFingerPrint_node = { float(node->GetLabel()), float(ModePolicy::PaintOver), float(ModePolicy::NecroticRegion), node->GetHistogramMedian() };
+  if (!ModePolicy::PaintOver && ModePolicy::NecroticRegion)
+    labelCostsFingerPrint_node.push_back( node->GetThreshold() );
+
+  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
+  if (labelCostsFingerPrint != labelCostsFingerPrint_node || LabelCosts_saved.Offsets.size() != size_t(numVertices+1))
+  {
+    //Multithreaded label cost calculation, every vertex writes its own row.
+    AllocateColumnSamples(node, LabelCosts_saved);
+    itk::Workers().RunFunctionForRange<int, const CostStageInputsType*, ColumnSamplesType<float>*>
+      (&SetLabelCostsForVertex<ModePolicy>, 0, numVertices-1, &inputs, &LabelCosts_saved);
+    labelCostsFingerPrint = labelCostsFingerPrint_node;
+  }
+  return LabelCosts_saved;
+}
+
+//----------------------------------------------------------------------------
+template <class ModePolicy>
+void vtkSlicerPETTumorSegmentationLogic::SetLabelCostsForVertex(int vertexId, const CostStageInputsType* inputs, ColumnSamplesType<float>* labelCosts)
+{
+  vtkMRMLPETTumorSegmentationParametersNode* node = inputs->Node;
+  OSFSurfaceType::ColumnCostsSpan costs = labelCosts->GetWritableColumn(vertexId);
+  if (!ModePolicy::PaintOver)
+    AddLabelAvoidanceCostsForVertex<ModePolicy>(node, inputs->UptakeSamples->GetColumn(vertexId), (*inputs->LabelRuns)[vertexId], costs); //Adds the costs to reject other objects
+  else if (ModePolicy::NecroticRegion)
+    AddDefaultNecroticCostsForVertex(node, (*inputs->LabelRuns)[vertexId], costs);  //Adds the costs for necrotic mode, if it is active and label avoidance is not
+}
+
+//----------------------------------------------------------------------------
+template <class ModePolicy>
+void vtkSlicerPETTumorSegmentationLogic::SetGlobalGraphCostsForVertex(int vertexId, const CostStageInputsType* inputs)
+{
+  //The base costs based on the threshold, as well as the standard rejection, and the label costs are already set by SetGraphCostsForMode.
+  vtkMRMLPETTumorSegmentationParametersNode* node = inputs->Node;
+  if (ModePolicy::Splitting)
+    AddSplittingCostsForVertex(vertexId, node, inputs->UptakeSamples->GetColumn(vertexId), inputs->StrongWatershedSamples->GetColumn(vertexId), inputs->WeakWatershedSamples->GetColumn(vertexId)); //Adds the costs for splitting, if active
+}
+
+//----------------------------------------------------------------------------
+template <class ModePolicy>
+void vtkSlicerPETTumorSegmentationLogic::SetGlobalBaseGraphCosts(vtkMRMLPETTumorSegmentationParametersNode* node, const ColumnSamplesType<float>& uptakeSamples)
 {
   // get parameters
   const std::vector<float>& histogram = node->GetHistogram();
@@ -357,61 +566,93 @@ void vtkSlicerPETTumorSegmentationLogic::SetGlobalBaseGraphCostsForVertex(int ve
   float threshold = node->GetThreshold();
   float lowerBound = node->GetHistogramMedian();
   float centerpointUptake = node->GetCenterpointUptake();
-  bool necroticRegion = node->GetNecroticRegion();
-  bool linearCost = node->GetLinearCost();
+  const bool necroticRegion = ModePolicy::NecroticRegion;
+  const bool linearCost = ModePolicy::LinearCost;
+  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+  int numVertices = surface->GetNumberOfVertices();
+  size_t numNodes = uptakeSamples.Values.size();
+
+  // the costs are written straight into the packed costs of the graph if its columns are the rows of the samples
+  const OSFSurfaceType::PackedColumnOffsetsContainer& packedOffsets = surface->GetPackedColumnOffsets();
+  bool writePacked = surface->GetColumnsPacked() && packedOffsets.size() == uptakeSamples.Offsets.size()
+    && std::equal(packedOffsets.begin(), packedOffsets.end(), uptakeSamples.Offsets.begin());
+  std::vector<float> unpackedCosts;
+  float* costs = nullptr;
+  if (writePacked)
+    costs = surface->GetWritablePackedColumnCosts().data();
+  else
+  {
+    unpackedCosts.resize(numNodes);
+    costs = unpackedCosts.data();
+  }
 
-  // calculate base cost
-  std::vector<float> costs(uptakeValues.size(), 1.0);
-  for (size_t i=0; i<costs.size(); i++)
+  // calculate base cost of all nodes of all columns in one pass
+  //Every case is evaluated and the one for the uptake is selected, so the loop has no branches and can be vectorized.
+  //The linear cost flag is fixed by the mode policy, so only the cost of its mode is computed.
+  //The histogram is read from a copy with all bins, so the lookup is safe for nodes that do not use it.
+  std::vector<float> binCosts(numHistogramBins, 0.0);
+  std::copy_n(histogram.begin(), std::min(histogram.size(), binCosts.size()), binCosts.begin());
+  const float* uptakeValues = uptakeSamples.Values.data();
+  const float histogramSize = float(histogram.size());
+  const float lastBin = float(numHistogramBins-1);
+  const bool centerAboveThreshold = centerpointUptake>threshold;
+  const float aboveThresholdRange = centerAboveThreshold ? centerpointUptake-threshold : 1.0f;
+  for (size_t i=0; i<numNodes; i++)
   {
     float uptake = uptakeValues[i];
-    float cost = 0.0;
-
-    if (uptake<threshold && !linearCost)
-    { //cost below threshold w/o linear cost indexes into the histogram
-      int index = (int) ((uptake / histogramRange) * histogram.size());
-      index = std::max( std::min(index, int(numHistogramBins)-1), 0);
-      cost = histogram[index];
-    }
-    else if (uptake<threshold && linearCost)
-      cost = 1.0 - (uptake / threshold);  //cost below threshold w/ linear cost is a linear with cost 1 at uptake 0 and cost 0 at uptake of the threshold
-    else if (uptake==threshold) //cost is 0 at the threshold
-      cost = 0.0;
-    else if (uptake>threshold && centerpointUptake>threshold)
-      cost = (uptake-threshold)/(centerpointUptake-threshold);  //cost above threshold w/ center above threshold is linear with cost 1 at uptake of the center and cost 0 at uptake of the threshold
-    else
-      cost = 1.0; //cost above threshold with a center value below the threshold breaks the linear function, so it's just 1.0 by default
-    costs[i] = cost;
+    //cost below threshold w/o linear cost indexes into the histogram
+    float bin = std::min( std::max((uptake / histogramRange) * histogramSize, 0.0f), lastBin);
+    float histogramCost = binCosts[int(bin)];
+    //cost below threshold w/ linear cost is a linear with cost 1 at uptake 0 and cost 0 at uptake of the threshold
+    float belowThresholdCost = linearCost ? 1.0f - (uptake / threshold) : histogramCost;
+    //cost above threshold w/ center above threshold is linear with cost 1 at uptake of the center and cost 0 at uptake of the threshold,
+    //with a center value below the threshold it breaks the linear function, so it's just 1.0 by default
+    float aboveThresholdCost = centerAboveThreshold ? (uptake-threshold)/aboveThresholdRange : 1.0f;
+    //cost is 0 at the threshold
+    costs[i] = uptake<threshold ? belowThresholdCost : (uptake==threshold ? 0.0f : aboveThresholdCost);
   }
 
   // add rejections
-  bool belowMin = false;
-  bool aboveThres = true;
-  if (necroticRegion == true) //if necrotic, uptake must first go above threshold before it can be checked as being below the minimum
-  { aboveThres = false; }
-
-  //rejection
-  for (size_t i=0; i<costs.size(); i++)
+  //Once the uptake is too low (if necrotic, only after it went above threshold), all nodes beyond are rejected to avoid including outside objects.
+  //This running condition is decided by the first node where it holds, so each column is searched for it and then rejected without branches.
+  for (int vertexId=0; vertexId<numVertices; vertexId++)
   {
-    if (i<size_t(minNodeRejections)) // too close to center
-      costs[i]+=rejectionValue;
+    unsigned int columnBegin = uptakeSamples.Offsets[vertexId];
+    unsigned int columnSize = uptakeSamples.Offsets[vertexId+1]-columnBegin;
+    const float* columnUptakes = uptakeValues + columnBegin;
+    float* columnCosts = costs + columnBegin;
 
-    if (necroticRegion && uptakeValues[i]>threshold)  //mark above threshold when necrotic mode is active
-      aboveThres = true;
-    if (aboveThres && uptakeValues[i]<lowerBound) // uptake too low, reject any beyond in order to avoid including outside objects
-      belowMin = true;
-    if (belowMin && i>size_t(minNodeRejections))  // rejection applied, even if uptake returns above minimum value
-      costs[i]+=rejectionValue;
+    unsigned int firstBelowMin = 0;
+    if (necroticRegion == true) //if necrotic, uptake must first go above threshold before it can be checked as being below the minimum
+    {
+      while (firstBelowMin < columnSize && !(columnUptakes[firstBelowMin] > threshold))
+      { firstBelowMin++;  }
+    }
+    while (firstBelowMin < columnSize && !(columnUptakes[firstBelowMin] < lowerBound))
+    { firstBelowMin++;  }
+
+    for (unsigned int i=0; i<columnSize; i++)
+    {
+      //too close to center, or rejection applied, even if uptake returns above minimum value
+      bool rejected = int(i)<minNodeRejections || (i>=firstBelowMin && int(i)>minNodeRejections);
+      columnCosts[i] += rejected ? rejectionValue : 0.0f;
+    }
   }
 
-  // set costs for vertex
-  using ColumnCostsContainer = OSFSurfaceType::ColumnCostsContainer;
-  ColumnCostsContainer::Pointer columnCosts = node->GetOSFGraph()->GetSurface()->GetColumnCosts( vertexId );
-  columnCosts->CastToSTLContainer() = costs;
+  // set costs for vertices
+  if (!writePacked)
+  {
+    for (int vertexId=0; vertexId<numVertices; vertexId++)
+    {
+      OSFSurfaceType::ColumnCostsSpan columnCosts = surface->GetWritableColumnCostsSpan( vertexId );
+      std::copy( unpackedCosts.begin()+uptakeSamples.Offsets[vertexId], unpackedCosts.begin()+uptakeSamples.Offsets[vertexId+1], columnCosts.begin() );
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::AddLabelAvoidanceCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, const std::vector<float>& uptakeValues, LabelInterpolatorType::Pointer labelInterpolator)
+template <class ModePolicy>
+void vtkSlicerPETTumorSegmentationLogic::AddLabelAvoidanceCostsForVertex(vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplesSpan<float> uptakeValues, const LabelRunsContainer& labelRuns, OSFSurfaceType::ColumnCostsSpan costs)
 {
 /*
 Requirements:
@@ -425,11 +666,10 @@ Requirements:
   float threshold = node->GetThreshold();
   float lowerBound = node->GetHistogramMedian();
   int label = node->GetLabel();
-  const std::vector<short> labelValues = SampleColumnPoints<short, LabelInterpolatorType>(vertexId, node, labelInterpolator);
-  std::vector<float>& costs = node->GetOSFGraph()->GetSurface()->GetColumnCosts( vertexId )->CastToSTLContainer();
-  bool necroticRegion = node->GetNecroticRegion();
+  const bool necroticRegion = ModePolicy::NecroticRegion;
 
-  // add rejections
+  // add rejections; the label changes to another object at the first node of its run
+  const unsigned int firstOtherLabelNode = GetFirstOtherLabelNode(labelRuns, label, 0);
   bool labelChanged = false;
   bool belowMin = false;
   bool aboveThres = true;
@@ -439,7 +679,7 @@ Requirements:
   for (size_t i=0; i<costs.size(); i++)
   {
     //detect label changed, signalling need to reject
-    if (labelValues[i]!=0 && labelValues[i]!=label)
+    if (i >= firstOtherLabelNode)
       labelChanged = true;
 
     //determine if already rejected
@@ -471,38 +711,43 @@ Requirements:
       firstCheckedNode = j;
 
     //go along the column from the center and find out if there's a node to seal to for necrotic mode
-    for (size_t i=vtkSlicerPETTumorSegmentationLogic::minNodeRejections; i<costs.size()-1; i++)
+    //only the run of zero labels the search starts in is searched; if already at a nonzero label, done trying to seal
+    LabelRunsContainer::const_iterator run = labelRuns.begin();
+    while (run != labelRuns.end() && run->Last < unsigned(minNodeRejections))
+    { ++run;  }
+    if (run != labelRuns.end() && run->Label == 0)
     {
-      //search in first set of zero labels
-      if (labelValues[i] == 0)
+      for (size_t i=vtkSlicerPETTumorSegmentationLogic::minNodeRejections; i<costs.size()-1 && i<=run->Last; i++)
       {
         //if i is in proper region to leave necrotic mode, done trying to seal on this column
         if (int(i)-1 > firstCheckedNode && uptakeValues[i] < uptakeValues[i-1])  //i-1 = j', i = j'' in the thesis.  This checks the case to cancel the necrotic sealing condition.
         { i = costs.size()-1; }
-        else if (labelValues[i+1] == label) //otherwise, if next node is the sought label, seal to it and end the search
+        else if (i == run->Last) //otherwise, at the end of the zero labels, seal to the next node if it is the sought label, not if it is some other label; end the search
         {
-          nodeToSeal = i;
+          if ((run+1)->Label == label)
+          { nodeToSeal = i; }
           i = costs.size()-1;
         }
-        else if (labelValues[i+1] != 0) //otherwise, if the next node is some other label, do not seal to it; end the search
-        { i = costs.size()-1; }
       }
-      else  //if already at a nonzero label, done trying to seal
-      { i = costs.size()-1; }
     }
   }
 
   //apply base cost seal condition, if not already sealed by necrotic sealing condition
   if (nodeToSeal == -1)
   {
+    unsigned int otherLabelNode = GetFirstOtherLabelNode(labelRuns, label, minNodeRejections);
     for (size_t i=vtkSlicerPETTumorSegmentationLogic::minNodeRejections; i<size_t(costs.size()) && nodeToSeal < 0 && doNotSeal == false; i++)
     {
-      if (labelValues[i]!=0 && labelValues[i]!=label && (int(i) < firstCheckedNode || int(i) < minNodeRejections)) // Prevents sealing if earlier labels occur before leaving the close rejected region or, in necrotic mode, the necrotic region
+      if (i > otherLabelNode)
+      { otherLabelNode = GetFirstOtherLabelNode(labelRuns, label, i);  }
+      bool otherLabel = (i == otherLabelNode);
+
+      if (otherLabel && (int(i) < firstCheckedNode || int(i) < minNodeRejections)) // Prevents sealing if earlier labels occur before leaving the close rejected region or, in necrotic mode, the necrotic region
       { doNotSeal = true; }
 
       //continues incrementing the node to seal if there is no decrease yet.
       //If there's another label on current node, then seal here; the previous i value (at minNodeRejections or higher) has already been checked by the next if statement, as verified by doNotSeal being false.
-      if (int(i) > minNodeRejections && int(i) >= firstCheckedNode && labelValues[i]!=0 && labelValues[i]!=label)
+      if (int(i) > minNodeRejections && int(i) >= firstCheckedNode && otherLabel)
       {
         if (doNotSeal == false)
         { nodeToSeal = i-1; }
@@ -529,24 +774,22 @@ Requirements:
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::AddDefaultNecroticCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, LabelInterpolatorType::Pointer labelInterpolator)
+void vtkSlicerPETTumorSegmentationLogic::AddDefaultNecroticCostsForVertex(vtkMRMLPETTumorSegmentationParametersNode* node, const LabelRunsContainer& labelRuns, OSFSurfaceType::ColumnCostsSpan costs)
 {
   //default necrotic costs seal to the first matching label
   int label = node->GetLabel();
-  const std::vector<short> labelValues = SampleColumnPoints<short, LabelInterpolatorType>(vertexId, node, labelInterpolator);
-  std::vector<float>& costs = node->GetOSFGraph()->GetSurface()->GetColumnCosts( vertexId )->CastToSTLContainer();
 
   int nodeToSeal = -1;
 
-  for (size_t i=0; i<costs.size()-1; i++)
+  for (LabelRunsContainer::const_iterator run = labelRuns.begin(); run != labelRuns.end() && run+1 != labelRuns.end(); ++run)
   {
-    //find first node where next label is ours when current label is background
-    if (labelValues[i] == 0)
+    //find last node of a background run where the next run is ours, until the next run is another label
+    if (run->Label == 0)
     {
-      if (labelValues[i+1] == label)
-      { nodeToSeal = i; }
-      else if (labelValues[i+1] != 0)
-      { i = costs.size()-1; }
+      if ((run+1)->Label == label)
+      { nodeToSeal = run->Last; }
+      else
+      { break; }
     }
   }
 
@@ -566,7 +809,18 @@ void vtkSlicerPETTumorSegmentationLogic::AddDefaultNecroticCostsForVertex(int ve
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::AddSplittingCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, const std::vector<float>& uptakeValues, WatershedInterpolatorType::Pointer strongWatershedInterpolator, WatershedInterpolatorType::Pointer weakWatershedInterpolator)
+unsigned int vtkSlicerPETTumorSegmentationLogic::GetFirstOtherLabelNode(const LabelRunsContainer& labelRuns, int label, unsigned int firstNode)
+{
+  for (const LabelRunType& run : labelRuns)
+  {
+    if (run.Last >= firstNode && run.Label != 0 && run.Label != label)
+    { return std::max(run.First, firstNode);  }
+  }
+  return std::numeric_limits<unsigned int>::max();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::AddSplittingCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplesSpan<float> uptakeValues, ColumnSamplesSpan<WatershedPixelType> strongWatershedValues, ColumnSamplesSpan<WatershedPixelType> weakWatershedValues)
 {
   /*
   Requirements:
@@ -578,9 +832,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddSplittingCostsForVertex(int vertexId
   */
 
   float threshold = node->GetThreshold();
-  const std::vector<WatershedPixelType> strongWatershedValues = SampleColumnPoints<WatershedPixelType, WatershedInterpolatorType>(vertexId, node, strongWatershedInterpolator);
-  const std::vector<WatershedPixelType> weakWatershedValues = SampleColumnPoints<WatershedPixelType, WatershedInterpolatorType>(vertexId, node, weakWatershedInterpolator);
-  std::vector<float>& costs = node->GetOSFGraph()->GetSurface()->GetColumnCosts( vertexId )->CastToSTLContainer();
+  OSFSurfaceType::ColumnCostsSpan costs = node->GetOSFGraph()->GetSurface()->GetWritableColumnCostsSpan( vertexId );
 
   float sigma = 2.0;
   bool anyFeature = false;
@@ -627,25 +879,85 @@ void vtkSlicerPETTumorSegmentationLogic::AddSplittingCostsForVertex(int vertexId
 
 //----------------------------------------------------------------------------
 template <typename valueType, class ImageInterpolatorType>
-std::vector<valueType>
-vtkSlicerPETTumorSegmentationLogic::SampleColumnPoints(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, typename ImageInterpolatorType::Pointer interpolator, valueType defaultValue)
+void
+vtkSlicerPETTumorSegmentationLogic::SampleColumnPoints(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, typename ImageInterpolatorType::Pointer interpolator, ColumnSamplesType<valueType>* samples)
 {
-  //Copy all the uptake values interpolated on the column's nodes into a vector.
-  using ColumnCoordinatesContainer = OSFSurfaceType::ColumnCoordinatesContainer;
-
-  ColumnCoordinatesContainer::ConstPointer columnCoordinates = node->GetOSFGraph()->GetSurface()->GetColumnCoordinates( vertexId );
-  ColumnCoordinatesContainer::ConstIterator coordItr = columnCoordinates->Begin();
-  ColumnCoordinatesContainer::ConstIterator coordEnd = columnCoordinates->End();
-  std::vector<valueType> values( columnCoordinates->Size(), defaultValue );
-  size_t i = 0;
-  while (coordItr!=coordEnd)
+  //Copy all the values interpolated on the column's nodes into the row of the vertex.  Nodes outside of the image keep the value 0.
+  OSFSurfaceType::ConstColumnCoordinatesSpan columnCoordinates = node->GetOSFGraph()->GetSurface()->GetColumnCoordinatesSpan( vertexId );
+  valueType* values = samples->Values.data() + samples->Offsets[vertexId];
+  for (size_t i=0; i<columnCoordinates.size(); ++i)
   {
-    if ( interpolator->IsInsideBuffer(coordItr.Value()) )
-      values[i] = interpolator->Evaluate(coordItr.Value());
-    ++coordItr; ++i;
+    if ( interpolator->IsInsideBuffer(columnCoordinates[i]) )
+      values[i] = interpolator->Evaluate(columnCoordinates[i]);
   }
+}
 
-  return values;
+//----------------------------------------------------------------------------
+template <typename valueType, class ImageInterpolatorType>
+void
+vtkSlicerPETTumorSegmentationLogic::SampleColumns(vtkMRMLPETTumorSegmentationParametersNode* node, typename ImageInterpolatorType::Pointer interpolator, ColumnSamplesType<valueType>& samples)
+{
+  AllocateColumnSamples(node, samples);
+
+  //Multithreaded sampling, every vertex writes its own row.
+  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
+  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*, typename ImageInterpolatorType::Pointer, ColumnSamplesType<valueType>*>
+    (&SampleColumnPoints<valueType, ImageInterpolatorType>, 0, numVertices-1, node, interpolator, &samples);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::SampleColumnPointsLinear(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplerType::ConstPointer sampler, ColumnSamplesType<float>* samples)
+{
+  OSFSurfaceType::ConstColumnCoordinatesSpan columnCoordinates = node->GetOSFGraph()->GetSurface()->GetColumnCoordinatesSpan( vertexId );
+  sampler->SampleColumn( columnCoordinates.begin(), columnCoordinates.size(), samples->Values.data() + samples->Offsets[vertexId] );
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::SampleColumnsLinear(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer image, ColumnSamplesType<float>& samples)
+{
+  AllocateColumnSamples(node, samples);
+  ColumnSamplerType::Pointer sampler = ColumnSamplerType::New();
+  sampler->SetInputImage( image );
+
+  //Multithreaded sampling, every vertex writes its own row.
+  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
+  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*, ColumnSamplerType::ConstPointer, ColumnSamplesType<float>*>
+    (&SampleColumnPointsLinear, 0, numVertices-1, node, ColumnSamplerType::ConstPointer(sampler), &samples);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::SampleColumnLabelRuns(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, LabelColumnSamplerType::ConstPointer sampler, ColumnLabelRunsType* labelRuns)
+{
+  OSFSurfaceType::ConstColumnCoordinatesSpan columnCoordinates = node->GetOSFGraph()->GetSurface()->GetColumnCoordinatesSpan( vertexId );
+  sampler->SampleColumnRuns( columnCoordinates.begin(), columnCoordinates.size(), (*labelRuns)[vertexId] );
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::SampleColumnsLabelRuns(vtkMRMLPETTumorSegmentationParametersNode* node, LabelImageType::Pointer image, ColumnLabelRunsType& labelRuns)
+{
+  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
+  labelRuns.assign(numVertices, LabelRunsContainer());
+  LabelColumnSamplerType::Pointer sampler = LabelColumnSamplerType::New();
+  sampler->SetInputImage( image );
+
+  //Multithreaded sampling, every vertex writes its own runs.
+  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*, LabelColumnSamplerType::ConstPointer, ColumnLabelRunsType*>
+    (&SampleColumnLabelRuns, 0, numVertices-1, node, LabelColumnSamplerType::ConstPointer(sampler), &labelRuns);
+}
+
+//----------------------------------------------------------------------------
+template <typename valueType>
+void
+vtkSlicerPETTumorSegmentationLogic::AllocateColumnSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplesType<valueType>& samples)
+{
+  //Nodes outside of the image keep the value 0.
+  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+  int numVertices = surface->GetNumberOfVertices();
+  samples.Offsets.resize(numVertices+1);
+  samples.Offsets[0] = 0;
+  for (int vertexId=0; vertexId<numVertices; ++vertexId)
+    samples.Offsets[vertexId+1] = samples.Offsets[vertexId] + surface->GetNumberOfColumns(vertexId);
+  samples.Values.assign(samples.Offsets.back(), valueType(0));
 }
 
 //----------------------------------------------------------------------------
@@ -686,9 +998,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddLocalRefinementCosts(vtkMRMLPETTumor
 {
   OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
   surface->BuildNeighborLookupTable();
-
-  InterpolatorType::Pointer interpolator = InterpolatorType::New();
-  interpolator->SetInputImage( petVolume );
+  const ColumnSamplesType<float>& uptakeSamples = GetUptakeSamples(node, petVolume);
 
   // find node closest to refinement point and uptake values for template matching
   int vertexId = GetClosestVertex(node, refinementPoint);
@@ -697,7 +1007,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddLocalRefinementCosts(vtkMRMLPETTumor
     columnId = minNodeRejections;
   if (columnId > maxNodeRefinement)
     columnId = maxNodeRefinement;
-  std::vector<float> uptakeValues = SampleColumnPoints<float, InterpolatorType>(vertexId, node, interpolator);
+  ColumnSamplesSpan<float> uptakeValues = uptakeSamples.GetColumn(vertexId);
 
   // get similarity threshold
   float similarityThreshold = 0.0;
@@ -737,7 +1047,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddLocalRefinementCosts(vtkMRMLPETTumor
         continue;
 
       // find most similar uptake vector and obtain similarity meaure
-      const std::vector<float> neighborUptakeValues = SampleColumnPoints<float, InterpolatorType>(neighborVertexId, node, interpolator);
+      ColumnSamplesSpan<float> neighborUptakeValues = uptakeSamples.GetColumn(neighborVertexId);
       float similarity;
       int bestMatchColumnId = GetBestTemplateMatch(uptakeValues, columnId, templateMatchingHalfLength, neighborUptakeValues, distance+1, similarity);
 
@@ -772,7 +1082,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddLocalRefinementCosts(vtkMRMLPETTumor
   }
 
   // change costs for center vertex
-  std::vector<float>& costs = surface->GetColumnCosts(vertexId)->CastToSTLContainer();
+  OSFSurfaceType::ColumnCostsSpan costs = surface->GetWritableColumnCostsSpan(vertexId);
   if (!depth0ModifiedSequence[vertexId])
   {
     for (size_t i=0; i<costs.size(); i++)
@@ -787,7 +1097,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddLocalRefinementCosts(vtkMRMLPETTumor
       continue;
 
 
-    std::vector<float>& costs = surface->GetColumnCosts(vertexInRange[i])->CastToSTLContainer();
+    OSFSurfaceType::ColumnCostsSpan costs = surface->GetWritableColumnCostsSpan(vertexInRange[i]);
     int columnId = vertexMostSimilarColumnId[i];
     float distance = vertexDistance[i];
 
@@ -808,7 +1118,7 @@ void vtkSlicerPETTumorSegmentationLogic::AddLocalRefinementCosts(vtkMRMLPETTumor
 }
 
 //----------------------------------------------------------------------------
-int vtkSlicerPETTumorSegmentationLogic::GetBestTemplateMatch(std::vector<float> vecA, int idxA, int len, std::vector<float> vecB, int searchRange, float& matchingScore)
+int vtkSlicerPETTumorSegmentationLogic::GetBestTemplateMatch(ColumnSamplesSpan<float> vecA, int idxA, int len, ColumnSamplesSpan<float> vecB, int searchRange, float& matchingScore)
 {
   // obtain vector A
   std::vector<float> a(2*len+1, 0);
@@ -955,13 +1265,10 @@ bool vtkSlicerPETTumorSegmentationLogic::CalculateCenterPoint(vtkMRMLPETTumorSeg
 }
 
 //----------------------------------------------------------------------------
-vtkSlicerPETTumorSegmentationLogic::ScalarImageType::Pointer vtkSlicerPETTumorSegmentationLogic::ExtractPETSubVolume(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
+vtkSlicerPETTumorSegmentationLogic::RegionType vtkSlicerPETTumorSegmentationLogic::GetSphereRegion(vtkMRMLPETTumorSegmentationParametersNode* node, const itk::ImageBase<3>* image)
 {
-  if (petVolume.IsNull())
-    return nullptr;
-
   // identify ROI based on center point, sphere radius, plus a one voxel margin
-  ScalarImageType::RegionType roi;
+  RegionType roi;
 
   //Find upper and lower points based on the sphereMeshRadius and the centerPoint
   PointType centerPoint = node->GetCenterpoint();
@@ -969,21 +1276,21 @@ vtkSlicerPETTumorSegmentationLogic::ScalarImageType::Pointer vtkSlicerPETTumorSe
   pointA[0] = centerPoint[0] - meshSphereRadius;
   pointA[1] = centerPoint[1] - meshSphereRadius;
   pointA[2] = centerPoint[2] - meshSphereRadius;
-  ScalarImageType::IndexType idxA;
-  petVolume->TransformPhysicalPointToIndex(pointA, idxA);
+  IndexType idxA;
+  image->TransformPhysicalPointToIndex(pointA, idxA);
   PointType pointB;
   pointB[0] = centerPoint[0] + meshSphereRadius;
   pointB[1] = centerPoint[1] + meshSphereRadius;
   pointB[2] = centerPoint[2] + meshSphereRadius;
-  ScalarImageType::IndexType idxB;
-  petVolume->TransformPhysicalPointToIndex(pointB, idxB);
+  IndexType idxB;
+  image->TransformPhysicalPointToIndex(pointB, idxB);
 
   //Set size and location based on these points
-  ScalarImageType::SizeType ROISize;
+  RegionType::SizeType ROISize;
   ROISize[0] = abs( int(idxA[0])-int(idxB[0]) )+1;
   ROISize[1] = abs( int(idxA[1])-int(idxB[1]) )+1;
   ROISize[2] = abs( int(idxA[2])-int(idxB[2]) )+1;
-  ScalarImageType::IndexType ROIStart;
+  IndexType ROIStart;
   ROIStart[0] = std::min(idxA[0], idxB[0]);
   ROIStart[1] = std::min(idxA[1], idxB[1]);
   ROIStart[2] = std::min(idxA[2], idxB[2]);
@@ -992,8 +1299,18 @@ vtkSlicerPETTumorSegmentationLogic::ScalarImageType::Pointer vtkSlicerPETTumorSe
   roi.PadByRadius(1); //Margin of error on region
 
   // make sure ROI is fully inside of the given image
-  ScalarImageType::RegionType finalROI = petVolume->GetLargestPossibleRegion();
+  RegionType finalROI = image->GetLargestPossibleRegion();
   finalROI.Crop(roi);
+  return finalROI;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerPETTumorSegmentationLogic::ScalarImageType::Pointer vtkSlicerPETTumorSegmentationLogic::ExtractPETSubVolume(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
+{
+  if (petVolume.IsNull())
+    return nullptr;
+
+  ScalarImageType::RegionType finalROI = GetSphereRegion(node, petVolume);
 
   // extract subvolume
   using ROIExtractorType = itk::RegionOfInterestImageFilter<ScalarImageType, ScalarImageType>;
@@ -1122,15 +1439,35 @@ void vtkSlicerPETTumorSegmentationLogic::GenerateWatershedImages(vtkMRMLPETTumor
 //----------------------------------------------------------------------------
 void vtkSlicerPETTumorSegmentationLogic::CreateGraph(vtkMRMLPETTumorSegmentationParametersNode* node)
 {
-  PointType centerpoint = node->GetCenterpoint();
-
   // create graph structure using spherical mesh as initial surface.
+  // the topology of the sphere graph is always the same, so a copy of the cached graph around the origin is moved to the centerpoint
+  using CloneGraphFilterType = itk::CloneOSFGraphFilter<OSFGraphType>;
+  CloneGraphFilterType::Pointer cloner = CloneGraphFilterType::New();
+  cloner->SetInput( GetSphereGraphTemplate() );
+  cloner->Update();
+
+  node->SetOSFGraph( cloner->GetOutput() );
+  // move the columns from the origin to the center
+  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
+  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*>
+    (&TranslateColumnForVertex, 0, numVertices-1, node);
+}
 
-  // create a spherical mesh to base the graph off of
+//----------------------------------------------------------------------------
+vtkSlicerPETTumorSegmentationLogic::OSFGraphType::ConstPointer vtkSlicerPETTumorSegmentationLogic::GetSphereGraphTemplate()
+{
+  static std::mutex templateMutex;
+  static std::map<int, OSFGraphType::ConstPointer> templates;
+  std::lock_guard<std::mutex> lock(templateMutex);
+  OSFGraphType::ConstPointer& sphereGraph = templates[int(meshResolution)];
+  if (sphereGraph.IsNotNull())
+    return sphereGraph;
+
+  // create a spherical mesh around the origin to base the graph off of
   using RegularSphereMeshSourceType = itk::RegularSphereMeshSource<MeshType>;
   RegularSphereMeshSourceType::Pointer sphereMeshSource = RegularSphereMeshSourceType::New();
   RegularSphereMeshSourceType::PointType sphereCenter;
-  sphereCenter[0] = centerpoint[0];  sphereCenter[1] = centerpoint[1];  sphereCenter[2] = centerpoint[2];
+  sphereCenter.Fill(0);
   RegularSphereMeshSourceType::VectorType sphereRadius;
   sphereRadius.Fill(meshSphereRadius);
   sphereMeshSource->SetCenter( sphereCenter );
@@ -1142,20 +1479,50 @@ void vtkSlicerPETTumorSegmentationLogic::CreateGraph(vtkMRMLPETTumorSegmentation
   MeshToOSFGraphFilterType::Pointer meshToOSFGraphFilter = MeshToOSFGraphFilterType::New();
   meshToOSFGraphFilter->SetInput( sphereMeshSource->GetOutput() );
   meshToOSFGraphFilter->Update();
-
-  node->SetOSFGraph( meshToOSFGraphFilter->GetOutput() );
-  // create columns from the center to the vertices of the mesh
-  int numVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
-  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*>
-    (&BuildColumnForVertex, 0, numVertices-1, node);
+  OSFGraphType::Pointer graph = meshToOSFGraphFilter->GetOutput();
+  graph->DisconnectPipeline();
+
+  // create columns from the origin to the vertices of the mesh
+  int numVertices = graph->GetSurface()->GetNumberOfVertices();
+  itk::Workers().RunFunctionForRange<int, OSFGraphType*>
+    (&BuildColumnForVertex, 0, numVertices-1, graph.GetPointer());
+  graph->GetSurface()->BuildNeighborLookupTable();
+  graph->GetSurface()->PackColumns(); // contiguous columns for all graphs copied from the template
+
+  sphereGraph = graph.GetPointer();
+  return sphereGraph;
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::BuildColumnForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node)
+vtkSlicerPETTumorSegmentationLogic::OSFGraphType::ConstPointer vtkSlicerPETTumorSegmentationLogic::GetGraphBuilderTemplate(double softSmoothnessPenalty)
 {
-  PointType centerpoint = node->GetCenterpoint();
+  OSFGraphType::ConstPointer sphereGraph = GetSphereGraphTemplate();
+
+  static std::mutex templateMutex;
+  static std::map<std::tuple<int, int, double>, OSFGraphType::ConstPointer> templates;
+  std::lock_guard<std::mutex> lock(templateMutex);
+  OSFGraphType::ConstPointer& builderGraph = templates[std::make_tuple(int(meshResolution), int(hardSmoothnessConstraint), softSmoothnessPenalty)];
+  if (builderGraph.IsNotNull())
+    return builderGraph;
+
+  // nodes, node lookup table and edges only depend on the column sizes and the cells, not on the costs
+  using GraphBuilderType = itk::SimpleOSFGraphBuilderFilter<OSFGraphType,OSFGraphType>;
+  GraphBuilderType::Pointer graphBuilder = GraphBuilderType::New();
+  graphBuilder->SetInput( sphereGraph );
+  graphBuilder->SetSmoothnessConstraint( hardSmoothnessConstraint );
+  graphBuilder->SetSoftSmoothnessPenalty( softSmoothnessPenalty );
+  graphBuilder->Update();
+  OSFGraphType::Pointer graph = graphBuilder->GetOutput();
+  graph->DisconnectPipeline();
 
-  OSFSurfaceType::Pointer surface =  node->GetOSFGraph()->GetSurface();
+  builderGraph = graph.GetPointer();
+  return builderGraph;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::BuildColumnForVertex(int vertexId, OSFGraphType* graph)
+{
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
   using Coordinate = OSFSurfaceType::CoordinateType;
   using ColumnCoordinatesContainer = OSFSurfaceType::ColumnCoordinatesContainer;
 
@@ -1164,13 +1531,15 @@ void vtkSlicerPETTumorSegmentationLogic::BuildColumnForVertex(int vertexId, vtkM
   ColumnCoordinatesContainer::Pointer columnPositions = ColumnCoordinatesContainer::New();
   columnPositions->CreateIndex( numberOfSteps-1 );
 
-  // build columns along straight line from center outwards
+  // build columns along straight line from the origin outwards
+  PointType origin;
+  origin.Fill(0);
   PointType initialVertexPosition = surface->GetInitialVertexPosition( vertexId );
-  PointType::VectorType direction = initialVertexPosition-centerpoint;
+  PointType::VectorType direction = initialVertexPosition-origin;
   direction.Normalize();
-  for (int step=0; step<numberOfSteps; step++)  //Place each point based on the center point, the direction, and the number and size of the steps
+  for (int step=0; step<numberOfSteps; step++)  //Place each point based on the direction and the number and size of the steps
   {
-    Coordinate currentPosition = centerpoint + direction*columnStepSize*float(step+1);
+    Coordinate currentPosition = origin + direction*columnStepSize*float(step+1);
     columnPositions->SetElement( step, currentPosition );
   }
 
@@ -1179,6 +1548,15 @@ void vtkSlicerPETTumorSegmentationLogic::BuildColumnForVertex(int vertexId, vtkM
   surface->SetInitialVertexPositionIdentifier( vertexId, 0 );
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::TranslateColumnForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node)
+{
+  PointType::VectorType offset = node->GetCenterpoint().GetVectorFromOrigin();
+
+  for (OSFSurfaceType::CoordinateType& position : node->GetOSFGraph()->GetSurface()->GetWritableColumnCoordinatesSpan( vertexId ))
+    position += offset;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerPETTumorSegmentationLogic::ObtainHistogram(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
 {
@@ -1237,42 +1615,37 @@ void vtkSlicerPETTumorSegmentationLogic::MaxFlow(vtkMRMLPETTumorSegmentationPara
   if (graph.IsNull())
     return;
 
-  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+  SolvedCostHistory_saved.reset(); // set by the caller if the graph belongs to the cost history of the node
+
   // add smoothness constraints to graph
-  using GraphBuilderType = itk::SimpleOSFGraphBuilderFilter<OSFGraphType,OSFGraphType>;
-  GraphBuilderType::Pointer graphBuilder = GraphBuilderType::New();
-  graphBuilder->SetInput( graph );
-  graphBuilder->SetSmoothnessConstraint( hardSmoothnessConstraint );
-  graphBuilder->SetSoftSmoothnessPenalty( node->GetSplitting() ? softSmoothnessPenaltySplitting : softSmoothnessPenalty );
+  // the builder persists, so a graph with tracked dirty columns only has its nodes of these columns created again
+  if (OSFGraphBuilder_saved.IsNull())
+  {
+    OSFGraphBuilder_saved = OSFGraphBuilderType::New();
+    OSFGraphBuilder_saved->UpdateDirtyColumnsOnlyOn();
+  }
+  OSFGraphBuilder_saved->SetInput( graph );
+  OSFGraphBuilder_saved->SetSmoothnessConstraint( hardSmoothnessConstraint );
+  OSFGraphBuilder_saved->SetSoftSmoothnessPenalty( node->GetSplitting() ? softSmoothnessPenaltySplitting : softSmoothnessPenalty );
+  OSFGraphBuilder_saved->SetGraphTemplate( GetGraphBuilderTemplate(OSFGraphBuilder_saved->GetSoftSmoothnessPenalty()) ); // skips building the lookup tables and edges
+  OSFGraphBuilder_saved->Modified(); // the costs of a graph are written in place, without modifying the graph
 
   // run the max flow algorithm to solve the segmentation problem
-  using OSFGraphSolverType = itk::LOGISMOSOSFGraphSolverFilter<OSFGraphType,OSFGraphType>;
-  OSFGraphSolverType::Pointer osfGraphSolver = OSFGraphSolverType::New();
-  osfGraphSolver->SetInput( graphBuilder->GetOutput() );
-  osfGraphSolver->Update();
+  // the solver persists, so the graph only has to be updated by the capacities changed since the last solution
+  if (OSFGraphSolver_saved.IsNull())
+  {
+    OSFGraphSolver_saved = OSFGraphSolverType::New();
+    OSFGraphSolver_saved->ReuseSearchTreesOn();
+    OSFGraphSolver_saved->KeepMaxFlowGraphOn(); // if the solution cannot be continued, the graph is at least not allocated again
+  }
+  OSFGraphSolver_saved->SetInput( OSFGraphBuilder_saved->GetOutput() );
+  OSFGraphSolver_saved->Update();
 
-  OSFGraphType::Pointer solvedGraph = osfGraphSolver->GetOutput();
+  OSFGraphType::Pointer solvedGraph = OSFGraphSolver_saved->GetOutput();
+  solvedGraph->DisconnectPipeline(); // the node keeps this result, the next update creates a new output
   node->SetOSFGraph( solvedGraph );
 }
 
-//----------------------------------------------------------------------------
-vtkSlicerPETTumorSegmentationLogic::MeshType::Pointer vtkSlicerPETTumorSegmentationLogic::GetSegmentationMesh(vtkMRMLPETTumorSegmentationParametersNode* node)
-{
-  // extract the segmentation surface from the OSF graph as a mesh
-  OSFGraphType::Pointer solvedGraph = node->GetOSFGraph();
-  if (solvedGraph.IsNull())
-    return nullptr;
-
-  // Get resulting surface mesh from osf graph
-  using OSFGraphToMeshFilterType = itk::OSFGraphToMeshFilter<OSFGraphType,MeshType>;
-  OSFGraphToMeshFilterType::Pointer osfGraphToMeshFilter = OSFGraphToMeshFilterType::New();
-  osfGraphToMeshFilter->SetInput( solvedGraph );
-  osfGraphToMeshFilter->Update();
-  MeshType::Pointer segmentationMesh = osfGraphToMeshFilter->GetOutput();
-
-  return segmentationMesh;
-}
-
 //----------------------------------------------------------------------------
 void vtkSlicerPETTumorSegmentationLogic::CalculateThresholdHistogramBased(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
 {
@@ -1302,12 +1675,21 @@ void vtkSlicerPETTumorSegmentationLogic::CalculateThresholdHistogramBased(vtkMRM
   int numberOfShells = graph->GetSurface()->GetNumberOfColumns(0);
   std::vector<float> shellUptake(numberOfShells, 0.0);
   InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  ColumnSamplesType<float> medianUptakeSamples;
+  const ColumnSamplesType<float>* shellSamples = nullptr;
   if (node->GetDenoiseThreshold())  //determine shells on median pet volume only if needed
+  {
     interpolator->SetInputImage( medianPetVolume );
-  else
+    SampleColumnsLinear(node, medianPetVolume, medianUptakeSamples);
+    shellSamples = &medianUptakeSamples;
+  }
+  else  //otherwise the shells are the samples later used for the costs
+  {
     interpolator->SetInputImage( petVolume );
-  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*, std::vector<float>&, InterpolatorType::Pointer>
-    (&GetMedianUptakeForShell, 0, numberOfShells-1, node, shellUptake, interpolator);
+    shellSamples = &GetUptakeSamples(node, petVolume);
+  }
+  itk::Workers().RunFunctionForRange<int, vtkMRMLPETTumorSegmentationParametersNode*, std::vector<float>&, const ColumnSamplesType<float>*>
+    (&GetMedianUptakeForShell, 0, numberOfShells-1, node, shellUptake, shellSamples);
 
 
 
@@ -1397,22 +1779,15 @@ void vtkSlicerPETTumorSegmentationLogic::CalculateThresholdHistogramBased(vtkMRM
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerPETTumorSegmentationLogic::GetMedianUptakeForShell(int shellId, vtkMRMLPETTumorSegmentationParametersNode* node, std::vector<float>& shellUptakes, InterpolatorType::Pointer interpolator)
+void vtkSlicerPETTumorSegmentationLogic::GetMedianUptakeForShell(int shellId, vtkMRMLPETTumorSegmentationParametersNode* node, std::vector<float>& shellUptakes, const ColumnSamplesType<float>* uptakeSamples)
 {
-  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
-  unsigned int numberOfVertices = surface->GetNumberOfVertices();
+  unsigned int numberOfVertices = node->GetOSFGraph()->GetSurface()->GetNumberOfVertices();
   std::vector<float> shellValues(numberOfVertices, 0.0);
 
   // a shell is all nodes a certain distance from the center
   // median must be taken of uptake at all nodes at the distance
   for (unsigned int i=0; i<numberOfVertices; ++i)
-  {
-    const OSFSurfaceType::CoordinateType& coordinate = surface->GetColumnCoordinates(i)->ElementAt(shellId);
-    float uptake = 0;
-    if ( interpolator->IsInsideBuffer( coordinate ) )
-      uptake = interpolator->Evaluate( coordinate );
-    shellValues[i] = uptake;
-  }
+    shellValues[i] = uptakeSamples->GetColumn(i)[shellId];
 
   //sort and take middle index to get median
   std::sort(shellValues.begin(), shellValues.end());
@@ -1455,55 +1830,196 @@ void vtkSlicerPETTumorSegmentationLogic::CalculateThresholdPointLocationBased(vt
 }
 
 //----------------------------------------------------------------------------
-vtkSlicerPETTumorSegmentationLogic::LabelImageType::Pointer vtkSlicerPETTumorSegmentationLogic::GetSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, MeshType::Pointer segmentationMesh, LabelImageType::Pointer initialLabelMap)
+bool vtkSlicerPETTumorSegmentationLogic::LookupThresholdSweep(vtkMRMLPETTumorSegmentationParametersNode* node)
 {
-  if (segmentationMesh.IsNull() || initialLabelMap.IsNull())
-    return nullptr;
+  vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepPointer sweep = node->GetThresholdSweep();
+  OSFGraphType::Pointer graph = node->GetOSFGraph();
+  if (!sweep || graph.IsNull() || sweep->SettingsKey!=GetThresholdSweepSettingsKey(node))
+    return false;
+
+  // only thresholds that were solved during the sweep can be used, any other threshold is solved
+  if (sweep->Thresholds.empty())
+    return false;
+  size_t sweepId = GetClosestThresholdSweepIndex(*sweep, node->GetThreshold());
+  if (sweep->Thresholds[sweepId]!=node->GetThreshold())
+    return false;
+  const std::vector<unsigned int>& positions = sweep->Surfaces[sweepId];
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
+  if (positions.size()!=surface->GetNumberOfVertices())
+    return false;
 
-  // voxelize mesh
-  using MeshToLabelImageFilterType = itk::TriangleMeshToBinaryImageFilter<MeshType, LabelImageType>;
-  MeshToLabelImageFilterType::Pointer meshToImage = MeshToLabelImageFilterType::New();
-  meshToImage->SetInsideValue(1);
-  meshToImage->SetOutsideValue(0);
-  meshToImage->SetInput(segmentationMesh);
-  //meshToImage->SetInfoImage( initialLabelMap ); // this outputs information to the console; setting image info manually as done below does not output to the console
-  meshToImage->SetSpacing(initialLabelMap->GetSpacing());
-  meshToImage->SetOrigin(initialLabelMap->GetOrigin());
-  meshToImage->SetSize(initialLabelMap->GetLargestPossibleRegion().GetSize());
-  meshToImage->SetIndex(initialLabelMap->GetLargestPossibleRegion().GetIndex());
-  meshToImage->Update();
-  LabelImageType::Pointer segmentation = meshToImage->GetOutput();
-
-  if (node->GetPaintOver() == false)
-  { //remove voxels in other lesions
-    short label = node->GetLabel();
-    using IteratorType = itk::ImageRegionIterator<LabelImageType>;
-    IteratorType labelIt(initialLabelMap, initialLabelMap->GetLargestPossibleRegion());
-    IteratorType newIt(segmentation, segmentation->GetLargestPossibleRegion());
-    while (!(labelIt.IsAtEnd() || newIt.IsAtEnd()))
+  // a global refinement point penalizes all nodes of its column but the closest one; if the cached surface already
+  // passes through that node, it is still optimal for the penalized costs, otherwise the graph has to be solved
+  vtkMRMLMarkupsFiducialNode* globalRefinementFiducials = static_cast<vtkMRMLMarkupsFiducialNode*>( node->GetScene()->GetNodeByID( node->GetGlobalRefinementIndicatorListReference()) );
+  if (globalRefinementFiducials!=nullptr && globalRefinementFiducials->GetNumberOfControlPoints()!=0)
+  {
+    PointType refinementPoint = convert2ITK( globalRefinementFiducials->GetNthControlPointPosition(globalRefinementFiducials->GetNumberOfControlPoints()-1) );
+    int vertexId = GetClosestVertex(node, refinementPoint);
+    int columnId = GetClosestColumnOnVertex(node, refinementPoint, vertexId);
+    if (positions[vertexId]!=static_cast<unsigned int>(columnId))
+      return false;
+  }
+
+  for (size_t vertexId=0; vertexId<positions.size(); ++vertexId)
+    surface->SetCurrentVertexPositionIdentifier(vertexId, positions[vertexId]);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::size_t vtkSlicerPETTumorSegmentationLogic::GetThresholdSweepSettingsKey(vtkMRMLPETTumorSegmentationParametersNode* node)
+{
+  // summarizes all settings besides the threshold that change the graph costs, including the positions of the local refinement points
+  std::size_t key = 0;
+  key |= node->GetPaintOver() ? 1 : 0;
+  key |= node->GetNecroticRegion() ? 2 : 0;
+  key |= node->GetLinearCost() ? 4 : 0;
+  key |= node->GetSplitting() ? 8 : 0;
+  vtkMRMLMarkupsFiducialNode* localRefinementFiducials = static_cast<vtkMRMLMarkupsFiducialNode*>( node->GetScene()->GetNodeByID( node->GetLocalRefinementIndicatorListReference()) );
+  if (localRefinementFiducials!=nullptr)
+  {
+    // FNV-1a style combination of the coordinates
+    const std::size_t prime = static_cast<std::size_t>(1099511628211ULL);
+    std::hash<double> hashCoordinate;
+    for (int i=0; i<localRefinementFiducials->GetNumberOfControlPoints(); ++i)
     {
-      if (labelIt.Get() != 0 && labelIt.Get() != label)
-      { newIt.Set(0); }
-      ++newIt;
-      ++labelIt;
+      vtkVector3d position = localRefinementFiducials->GetNthControlPointPosition(i);
+      for (int d=0; d<3; ++d)
+        key = (key ^ hashCoordinate(position[d])) * prime;
     }
   }
+  return key;
+}
 
-  // do 6-connected region growing to remove unconnected voxels that may result from the voxelization process
-  using ConnectedComponentFilterType = itk::ConnectedThresholdImageFilter< LabelImageType, LabelImageType >;
-  ConnectedComponentFilterType::Pointer connectedComponentFilter = ConnectedComponentFilterType::New();
-  connectedComponentFilter->SetInput( segmentation );
-  connectedComponentFilter->SetConnectivity(ConnectedComponentFilterType::FaceConnectivity);
-  ConnectedComponentFilterType::IndexType seed;
-  segmentation->TransformPhysicalPointToIndex( node->GetCenterpoint(), seed);
-  connectedComponentFilter->AddSeed(seed);
-  connectedComponentFilter->SetUpper(1);
-  connectedComponentFilter->SetLower(1);
-  connectedComponentFilter->Update();
-  segmentation = connectedComponentFilter->GetOutput();
+//----------------------------------------------------------------------------
+size_t vtkSlicerPETTumorSegmentationLogic::GetClosestThresholdSweepIndex(const vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepType& sweep, float threshold)
+{
+  size_t sweepId = 0;
+  for (size_t i=1; i<sweep.Thresholds.size(); ++i)
+    if (std::fabs(sweep.Thresholds[i]-threshold)<std::fabs(sweep.Thresholds[sweepId]-threshold))
+      sweepId = i;
+  return sweepId;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerPETTumorSegmentationLogic::LabelImageType::Pointer vtkSlicerPETTumorSegmentationLogic::GetSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, LabelImageType::Pointer initialLabelMap)
+{
+  OSFGraphType::Pointer solvedGraph = node->GetOSFGraph();
+  if (solvedGraph.IsNull() || initialLabelMap.IsNull())
+    return nullptr;
+
+  // the solved surface is star-shaped around the center with one radius per vertex of the sphere graph template
+  OSFSurfaceType::Pointer surface = solvedGraph->GetSurface();
+  const SphereDirectionIndexType& directionIndex = GetSphereDirectionIndex();
+  int numVertices = surface->GetNumberOfVertices();
+  if (numVertices==0 || size_t(numVertices)!=directionIndex.Directions.size() || directionIndex.TriangleVertices.empty())
+    return nullptr;
+
+  VoxelizationInputsType inputs;
+  inputs.DirectionIndex = &directionIndex;
+  inputs.Center = PointType(surface->GetColumnCoordinatesSpan(0)[0]) - directionIndex.FirstColumnPoints[0].GetVectorFromOrigin();
+  inputs.InverseRadii.resize(numVertices);
+  for (int vertexId=0; vertexId<numVertices; ++vertexId)
+  {
+    double squaredRadius = (PointType(surface->GetCurrentVertexPosition(vertexId)) - inputs.Center).GetSquaredNorm();
+    inputs.InverseRadii[vertexId] = 1.0/std::sqrt(squaredRadius);
+    inputs.MaximumSquaredRadius = std::max(inputs.MaximumSquaredRadius, squaredRadius);
+  }
+
+  // the surface cannot leave the mesh sphere, so only the bounding box of the sphere is voxelized
+  LabelImageType::Pointer segmentation = LabelImageType::New();
+  segmentation->CopyInformation(initialLabelMap);
+  segmentation->SetRegions(initialLabelMap->GetLargestPossibleRegion());
+  segmentation->Allocate(true);
+  inputs.Region = GetSphereRegion(node, initialLabelMap);
+  inputs.Segmentation = segmentation;
+  if (node->GetPaintOver() == false) //remove voxels in other lesions
+    inputs.InitialLabelMap = initialLabelMap;
+  inputs.Label = node->GetLabel();
+  IndexType seed;
+  if (!segmentation->TransformPhysicalPointToIndex(node->GetCenterpoint(), seed) || !inputs.Region.IsInside(seed))
+    return segmentation;
+  itk::Workers().RunFunctionForRange<int, const VoxelizationInputsType*>
+    (&VoxelizeSurfaceSlice, int(inputs.Region.GetIndex(2)), int(inputs.Region.GetIndex(2)+inputs.Region.GetSize(2))-1, &inputs);
+
+  // keep only voxels 6-connected to the center voxel, which removes unconnected voxels at thin parts and behind other lesions;
+  // a flood fill from the center voxel marks the connected voxels with 2 before all others are removed
+  if (segmentation->GetPixel(seed)!=0)
+  {
+    std::queue<IndexType> queue;
+    segmentation->SetPixel(seed, 2);
+    queue.push(seed);
+    while (!queue.empty())
+    {
+      IndexType index = queue.front();
+      queue.pop();
+      for (int d=0; d<3; ++d)
+        for (int step=-1; step<=1; step+=2)
+        {
+          IndexType neighborIndex = index;
+          neighborIndex[d] += step;
+          if (!inputs.Region.IsInside(neighborIndex) || segmentation->GetPixel(neighborIndex)!=1)
+            continue;
+          segmentation->SetPixel(neighborIndex, 2);
+          queue.push(neighborIndex);
+        }
+    }
+  }
+  for (itk::ImageRegionIterator<LabelImageType> segmentationIt(segmentation, inputs.Region); !segmentationIt.IsAtEnd(); ++segmentationIt)
+    segmentationIt.Set(segmentationIt.Get()==2 ? 1 : 0); //nothing is kept if the center voxel is not set, e.g. if it is in another lesion
   return segmentation;
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::VoxelizeSurfaceSlice(int z, const VoxelizationInputsType* inputs)
+{
+  // a voxel is inside if it is not further away from the center than the surface in its direction
+  // with the direction as weighted sum of the vertex directions of its triangle, the ray hits the triangle of the surface
+  // at the weighted sum of the surface points divided by the sum of the weights divided by the radii
+  const SphereDirectionIndexType& directionIndex = *inputs->DirectionIndex;
+  const RegionType& region = inputs->Region;
+  LabelImageType* segmentation = inputs->Segmentation;
+  const LabelImageType* initialLabelMap = inputs->InitialLabelMap;
+  IndexType index;
+  index[2] = z;
+  for (index[1]=region.GetIndex(1); index[1]<=region.GetUpperIndex()[1]; ++index[1])
+  {
+    // consecutive voxels are mostly in the same or a neighboring triangle; the walk only starts from the cube map for a new row
+    bool walkFromCubeMap = true;
+    unsigned int triangleId = 0;
+    for (index[0]=region.GetIndex(0); index[0]<=region.GetUpperIndex()[0]; ++index[0])
+    {
+      if (initialLabelMap!=nullptr)
+      {
+        short label = initialLabelMap->GetPixel(index);
+        if (label != 0 && label != inputs->Label)
+          continue;
+      }
+      PointType point;
+      segmentation->TransformIndexToPhysicalPoint(index, point);
+      PointType::VectorType direction = point - inputs->Center;
+      double squaredDistance = direction.GetSquaredNorm();
+      if (squaredDistance > inputs->MaximumSquaredRadius)
+        continue;
+      if (squaredDistance == 0.0)
+      {
+        segmentation->SetPixel(index, 1);
+        continue;
+      }
+      if (walkFromCubeMap)
+      {
+        triangleId = directionIndex.CellTriangles[GetCubeMapCell(direction)];
+        walkFromCubeMap = false;
+      }
+      PointType::VectorType weights;
+      triangleId = GetTriangleOfDirection(directionIndex, direction, triangleId, weights);
+      const unsigned int* vertexIds = &directionIndex.TriangleVertices[3*triangleId];
+      double scale = weights[0]*inputs->InverseRadii[vertexIds[0]] + weights[1]*inputs->InverseRadii[vertexIds[1]] + weights[2]*inputs->InverseRadii[vertexIds[2]];
+      if (scale <= 1.0)
+        segmentation->SetPixel(index, 1);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerPETTumorSegmentationLogic::UpdateOutput(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer segmentation, LabelImageType::Pointer initialLabelMap)
 {
@@ -1527,6 +2043,8 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateOutput(vtkMRMLPETTumorSegmentatio
   segmentationMerger->SetPaintOver(paintOver);
   segmentationMerger->SetSealing(sealing);
   segmentationMerger->SetNecroticRegion(necroticRegion);
+  RegionType activeRegion = GetSphereRegion(node, initialLabelMap);
+  segmentationMerger->SetActiveRegion(activeRegion); // the new segmentation is empty outside of the mesh sphere
   segmentationMerger->Update();
   LabelImageType::Pointer labelMap = segmentationMerger->GetOutput();
 
@@ -1546,35 +2064,54 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateOutput(vtkMRMLPETTumorSegmentatio
     vtkSmartPointer<vtkOrientedImageData> referenceGeometry =
       vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(vtkPetVolume); // todo: this seems to be expensive just to get the orientation information
 
-    // iterate over all segments
+    // labels can only change in the active region of the merger plus the sealing margin
+    // the initial label map persists across refinements, so the segments may differ from it there; the whole region is
+    // replaced for the selected segment and, when painting over, for every segment present in it before or after the merge
+    RegionType changedRegion = activeRegion;
+    changedRegion.PadByRadius(1);
+    changedRegion.Crop(labelMap->GetLargestPossibleRegion());
     std::vector< std::string > segmentIds;
     vtkSegmentationNode->GetSegmentation()->GetSegmentIDs(segmentIds);
+    std::vector<bool> labelInRegion(segmentIds.size()+1, false);
+    if (paintOver)
+    {
+      itk::ImageRegionConstIterator<LabelImageType> labelMapIt(labelMap, changedRegion);
+      itk::ImageRegionConstIterator<LabelImageType> initialLabelMapIt(initialLabelMap, changedRegion);
+      for (; !labelMapIt.IsAtEnd(); ++labelMapIt, ++initialLabelMapIt)
+      {
+        short regionLabels[2] = { initialLabelMapIt.Get(), labelMapIt.Get() };
+        for (short regionLabel : regionLabels)
+          if (regionLabel > 0 && size_t(regionLabel) < labelInRegion.size())
+            labelInRegion[regionLabel] = true;
+      }
+    }
+
+    const IndexType& labelMapStart = labelMap->GetLargestPossibleRegion().GetIndex();
+    int extent[6];
+    for (int d=0; d<3; d++)
+    {
+      extent[2*d] = changedRegion.GetIndex(d)-labelMapStart[d];
+      extent[2*d+1] = changedRegion.GetIndex(d)+changedRegion.GetSize(d)-1-labelMapStart[d];
+    }
     for (size_t i=0; i<segmentIds.size(); i++)
     {
-      if (!node->GetPaintOver() && segmentIds[i]!=node->GetSelectedSegmentID())
+      if (segmentIds[i]!=node->GetSelectedSegmentID() && !labelInRegion[i+1])
         continue; // this segment doesn't need an update
       short label = i+1;
 
-      // get binary image of current segment
-      using BinaryThresholdImageFilterType = itk::BinaryThresholdImageFilter<LabelImageType, LabelImageType>;
-      BinaryThresholdImageFilterType::Pointer binaryThresholdFilter = BinaryThresholdImageFilterType::New();
-      binaryThresholdFilter->SetInput( labelMap );
-      binaryThresholdFilter->SetLowerThreshold( label );
-      binaryThresholdFilter->SetUpperThreshold( label );
-      binaryThresholdFilter->SetInsideValue(1);
-      binaryThresholdFilter->SetOutsideValue(0);
-      binaryThresholdFilter->Update();
-      LabelImageType::Pointer segmentLabelMap = binaryThresholdFilter->GetOutput();
-
-      // convert to vtk
+      // binary image of the segment in the region, with the geometry of the whole label map
       vtkSmartPointer<vtkOrientedImageData> vtkLabelVolume = vtkSmartPointer<vtkOrientedImageData>::New();
-      vtkSmartPointer<vtkImageData> vtkLabelMap = convert2VTK<LabelImageType>(segmentLabelMap, VTK_SHORT);
-      vtkLabelMap->SetSpacing(segmentLabelMap->GetSpacing()[0], labelMap->GetSpacing()[1], segmentLabelMap->GetSpacing()[2]);
-      vtkLabelMap->SetOrigin(-segmentLabelMap->GetOrigin()[0], -labelMap->GetOrigin()[1], segmentLabelMap->GetOrigin()[2]);
-      vtkLabelVolume->ShallowCopy(vtkLabelMap);vtkLabelVolume->CopyDirections(referenceGeometry);
+      vtkLabelVolume->SetExtent(extent);
+      vtkLabelVolume->AllocateScalars(VTK_SHORT, 1);
+      vtkLabelVolume->SetSpacing(labelMap->GetSpacing()[0], labelMap->GetSpacing()[1], labelMap->GetSpacing()[2]);
+      vtkLabelVolume->SetOrigin(-labelMap->GetOrigin()[0], -labelMap->GetOrigin()[1], labelMap->GetOrigin()[2]);
+      vtkLabelVolume->CopyDirections(referenceGeometry);
+      short* segmentVoxel = static_cast<short*>(vtkLabelVolume->GetScalarPointer());
+      for (itk::ImageRegionConstIterator<LabelImageType> changedRegionIt(labelMap, changedRegion); !changedRegionIt.IsAtEnd(); ++changedRegionIt, ++segmentVoxel)
+        *segmentVoxel = (changedRegionIt.Get() == label) ? 1 : 0;
 
       // update segment in segmentation
-      vtkSlicerSegmentationsModuleLogic::SetBinaryLabelmapToSegment(vtkLabelVolume, vtkSegmentationNode, segmentIds[i], vtkSlicerSegmentationsModuleLogic::MODE_REPLACE);
+      vtkSlicerSegmentationsModuleLogic::SetBinaryLabelmapToSegment(vtkLabelVolume, vtkSegmentationNode, segmentIds[i], vtkSlicerSegmentationsModuleLogic::MODE_REPLACE, extent);
     }
 
     referenceGeometry->Delete();
@@ -1668,6 +2205,32 @@ vtkSlicerPETTumorSegmentationLogic::convert2ITK(vtkSmartPointer<vtkImageData> vt
   return itkVolume;
 }
 
+//---------------------------------------------------------------------------
+template <class ITKImageType>
+typename ITKImageType::Pointer
+vtkSlicerPETTumorSegmentationLogic::import2ITK(vtkImageData* vtkVolume)
+{
+  using PixelType = typename ITKImageType::PixelType;
+  if (vtkVolume==nullptr || vtkVolume->GetScalarType()!=vtkTypeTraits<PixelType>::VTKTypeID() || vtkVolume->GetNumberOfScalarComponents()!=1)
+    return nullptr;
+
+  // create ITK image on the pixel buffer of the VTK image
+  typename ITKImageType::Pointer itkVolume = ITKImageType::New();
+  typename ITKImageType::RegionType region;
+  region.SetSize(0, vtkVolume->GetDimensions()[0]);
+  region.SetSize(1, vtkVolume->GetDimensions()[1]);
+  region.SetSize(2, vtkVolume->GetDimensions()[2]);
+  itkVolume->SetRegions( region );
+  itkVolume->SetSpacing( vtkVolume->GetSpacing() );
+
+  using PixelContainerType = VTKScalarsPixelContainer<PixelType>;
+  typename PixelContainerType::Pointer pixels = PixelContainerType::New();
+  pixels->SetImageData( vtkVolume );
+  pixels->SetImportPointer( static_cast<PixelType*>(vtkVolume->GetScalarPointer()), region.GetNumberOfPixels(), false );
+  itkVolume->SetPixelContainer( pixels );
+  return itkVolume;
+}
+
 //---------------------------------------------------------------------------
 template <class ITKImageType>
 vtkSmartPointer<vtkImageData> vtkSlicerPETTumorSegmentationLogic::convert2VTK(typename ITKImageType::Pointer itkVolume, const int TypeVTK)
@@ -1758,12 +2321,41 @@ int vtkSlicerPETTumorSegmentationLogic::GetClosestVertex(vtkMRMLPETTumorSegmenta
 
   // note: this implementation assumes that the mesh is spherical with straight columns pointing away from the center of the sphere
   // therefore, we only need to find the closest point on a shell and don't have to search the whole columns
-  OSFSurfaceType::Pointer surface = node->GetOSFGraph()->GetSurface();
+  // the first column points are at the same distance from the center, so the closest one has the direction closest to the direction of p
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
+  const SphereDirectionIndexType& directionIndex = GetSphereDirectionIndex();
   int numVertices = surface->GetNumberOfVertices();
-  std::vector<float> distancesSquared(numVertices,0.0);
-  for (int i=0; i<numVertices; ++i)
-    distancesSquared[i] = (surface->GetColumnCoordinates(i)->GetElement(0) - p).GetSquaredNorm();
-  return std::min_element(distancesSquared.begin(), distancesSquared.end()) - distancesSquared.begin();
+  if (numVertices==0 || size_t(numVertices)!=directionIndex.Directions.size())
+    return 0;
+
+  // the graph is a copy of the sphere graph template moved to the center point
+  PointType center = PointType(surface->GetColumnCoordinatesSpan(0)[0]) - directionIndex.FirstColumnPoints[0].GetVectorFromOrigin();
+  PointType::VectorType direction = p - center;
+  if (direction.GetSquaredNorm()==0.0)
+    return 0;
+
+  // start at the vertex of the cube map cell and walk to neighbors closer to the direction
+  // the regular sphere mesh is a Delaunay triangulation of its vertices, so a vertex without a closer neighbor is the closest vertex
+  unsigned int vertexId = directionIndex.CellVertices[GetCubeMapCell(direction)];
+  double bestDot = directionIndex.Directions[vertexId]*direction;
+  for (bool improved=true; improved; )
+  {
+    improved = false;
+    const OSFSurfaceType::VertexIdentifierContainer* neighbors = surface->GetNeighbors(vertexId);
+    if (neighbors==nullptr)
+      break;
+    for (OSFSurfaceType::VertexIdentifierContainer::ConstIterator neighborItr=neighbors->Begin(); neighborItr!=neighbors->End(); ++neighborItr)
+    {
+      double dot = directionIndex.Directions[neighborItr.Value()]*direction;
+      if (dot>bestDot)
+      {
+        bestDot = dot;
+        vertexId = neighborItr.Value();
+        improved = true;
+      }
+    }
+  }
+  return vertexId;
 }
 
 //---------------------------------------------------------------------------
@@ -1774,14 +2366,153 @@ int vtkSlicerPETTumorSegmentationLogic::GetClosestColumnOnVertex(vtkMRMLPETTumor
     return 0;
 
   // with the vertex already determined, this is easy
-  OSFSurfaceType::ColumnCoordinatesContainer::ConstPointer columnPoints = node->GetOSFGraph()->GetSurface()->GetColumnCoordinates(vertexId);
-  int numPoints = columnPoints->Size();
-  std::vector<float> distancesSquared(numPoints,0.0);
-  for (int i=0; i<numPoints; ++i)
-    distancesSquared[i] = (columnPoints->GetElement(i) - p).GetSquaredNorm();
-  return std::min_element(distancesSquared.begin(), distancesSquared.end()) - distancesSquared.begin();
+  // the column points are evenly spaced on a line, so the distance is smallest at the rounded position of the projection of p
+  OSFSurfaceType::ConstColumnCoordinatesSpan columnPoints = node->GetOSFGraph()->GetSurface()->GetColumnCoordinatesSpan(vertexId);
+  int numPoints = columnPoints.size();
+  if (numPoints<2)
+    return 0;
+  PointType first(columnPoints[0]);
+  PointType::VectorType axis = PointType(columnPoints[numPoints-1]) - first;
+  double position = ((p-first)*axis) / axis.GetSquaredNorm() * double(numPoints-1);
+  int columnId = int(std::ceil(position-0.5)); // ties go to the inner point
+  return std::max(0, std::min(columnId, numPoints-1));
 }
 
+//---------------------------------------------------------------------------
+const vtkSlicerPETTumorSegmentationLogic::SphereDirectionIndexType& vtkSlicerPETTumorSegmentationLogic::GetSphereDirectionIndex()
+{
+  OSFGraphType::ConstPointer sphereGraph = GetSphereGraphTemplate();
+
+  static std::mutex indexMutex;
+  static std::map<int, SphereDirectionIndexType> indices;
+  std::lock_guard<std::mutex> lock(indexMutex);
+  SphereDirectionIndexType& directionIndex = indices[int(meshResolution)];
+  if (!directionIndex.CellVertices.empty())
+    return directionIndex;
+
+  const OSFSurfaceType* surface = sphereGraph->GetSurface();
+  int numVertices = surface->GetNumberOfVertices();
+  directionIndex.Directions.resize(numVertices);
+  directionIndex.FirstColumnPoints.resize(numVertices);
+  for (int vertexId=0; vertexId<numVertices; ++vertexId)
+  {
+    directionIndex.FirstColumnPoints[vertexId] = PointType(surface->GetColumnCoordinatesSpan(vertexId)[0]);
+    directionIndex.Directions[vertexId] = directionIndex.FirstColumnPoints[vertexId].GetVectorFromOrigin();
+    directionIndex.Directions[vertexId].Normalize();
+  }
+
+  // triangles with their neighbors; each edge is shared by two triangles of the closed sphere mesh
+  std::map<std::pair<unsigned int, unsigned int>, std::pair<unsigned int, unsigned int>> edgeTriangles; // first triangle and its opposite corner of each edge
+  const OSFSurfaceType::CellsContainer* cells = surface->GetCells();
+  for (OSFSurfaceType::CellsContainer::ConstIterator cellItr=cells->Begin(); cellItr!=cells->End(); ++cellItr)
+  {
+    const OSFSurfaceType::CellType* cell = cellItr.Value();
+    if (cell->GetNumberOfPoints()!=3)
+      continue;
+    unsigned int triangleId = directionIndex.TriangleWeights.size();
+    itk::Matrix<double,3,3> vertexDirections;
+    const OSFSurfaceType::CellType::PointIdentifier* pointIds = cell->PointIdsBegin();
+    for (int corner=0; corner<3; ++corner)
+    {
+      directionIndex.TriangleVertices.push_back(pointIds[corner]);
+      directionIndex.TriangleNeighbors.push_back(triangleId);
+      for (int d=0; d<3; ++d)
+        vertexDirections[d][corner] = directionIndex.Directions[pointIds[corner]][d];
+    }
+    directionIndex.TriangleWeights.push_back( itk::Matrix<double,3,3>(vertexDirections.GetInverse()) );
+    for (int corner=0; corner<3; ++corner)
+    {
+      std::pair<unsigned int, unsigned int> edge = std::minmax( (unsigned int)(pointIds[(corner+1)%3]), (unsigned int)(pointIds[(corner+2)%3]) );
+      auto edgeItr = edgeTriangles.find(edge);
+      if (edgeItr==edgeTriangles.end())
+        edgeTriangles[edge] = std::make_pair(triangleId, (unsigned int)corner);
+      else
+      {
+        directionIndex.TriangleNeighbors[3*triangleId+corner] = edgeItr->second.first;
+        directionIndex.TriangleNeighbors[3*edgeItr->second.first+edgeItr->second.second] = triangleId;
+      }
+    }
+  }
+
+  // closest vertex to and triangle containing the center of each cell, by brute force once per mesh resolution
+  directionIndex.CellVertices.resize(6*cubeMapResolution*cubeMapResolution, 0);
+  directionIndex.CellTriangles.resize(6*cubeMapResolution*cubeMapResolution, 0);
+  for (int face=0; face<6; ++face)
+    for (int row=0; row<cubeMapResolution; ++row)
+      for (int column=0; column<cubeMapResolution; ++column)
+      {
+        // face 2*axis is the positive, face 2*axis+1 the negative side of the axis
+        int axis = face/2;
+        PointType::VectorType direction;
+        direction[axis] = (face%2==0) ? 1.0 : -1.0;
+        direction[(axis+1)%3] = 2.0*(column+0.5)/cubeMapResolution-1.0;
+        direction[(axis+2)%3] = 2.0*(row+0.5)/cubeMapResolution-1.0;
+        unsigned int closestVertexId = 0;
+        double bestDot = -std::numeric_limits<double>::infinity();
+        for (int vertexId=0; vertexId<numVertices; ++vertexId)
+        {
+          double dot = directionIndex.Directions[vertexId]*direction;
+          if (dot>bestDot)
+          {
+            bestDot = dot;
+            closestVertexId = vertexId;
+          }
+        }
+        directionIndex.CellVertices[GetCubeMapCell(direction)] = closestVertexId;
+
+        // the containing triangle has no negative weight, so it has the largest smallest weight
+        unsigned int containingTriangleId = 0;
+        double bestWeight = -std::numeric_limits<double>::infinity();
+        for (size_t triangleId=0; triangleId<directionIndex.TriangleWeights.size(); ++triangleId)
+        {
+          PointType::VectorType weights = directionIndex.TriangleWeights[triangleId]*direction;
+          double weight = std::min(weights[0], std::min(weights[1], weights[2]));
+          if (weight>bestWeight)
+          {
+            bestWeight = weight;
+            containingTriangleId = triangleId;
+          }
+        }
+        directionIndex.CellTriangles[GetCubeMapCell(direction)] = containingTriangleId;
+      }
+  return directionIndex;
+}
+
+//---------------------------------------------------------------------------
+unsigned int vtkSlicerPETTumorSegmentationLogic::GetCubeMapCell(const PointType::VectorType& direction)
+{
+  // the face is given by the component with the largest magnitude, the cell by the other components divided by it
+  int axis = 0;
+  for (int d=1; d<3; ++d)
+    if (std::fabs(direction[d])>std::fabs(direction[axis]))
+      axis = d;
+  double scale = 1.0/std::fabs(direction[axis]);
+  int face = 2*axis + (direction[axis]<0.0 ? 1 : 0);
+  int column = int((direction[(axis+1)%3]*scale+1.0)*0.5*cubeMapResolution);
+  int row = int((direction[(axis+2)%3]*scale+1.0)*0.5*cubeMapResolution);
+  column = std::max(0, std::min(column, cubeMapResolution-1));
+  row = std::max(0, std::min(row, cubeMapResolution-1));
+  return (face*cubeMapResolution+row)*cubeMapResolution+column;
+}
+
+//---------------------------------------------------------------------------
+unsigned int vtkSlicerPETTumorSegmentationLogic::GetTriangleOfDirection(const SphereDirectionIndexType& directionIndex, const PointType::VectorType& direction, unsigned int triangleId, PointType::VectorType& weights)
+{
+  // the direction is inside of a triangle if none of its weights is negative; otherwise, it is beyond the edge opposite to the
+  // vertex with the smallest weight, so walk across that edge. The small tolerance keeps directions on an edge from going back and forth.
+  for (size_t step=0; step<directionIndex.TriangleWeights.size(); ++step)
+  {
+    weights = directionIndex.TriangleWeights[triangleId]*direction;
+    int corner = 0;
+    for (int i=1; i<3; ++i)
+      if (weights[i]<weights[corner])
+        corner = i;
+    if (weights[corner] >= -1e-9*(weights[0]+weights[1]+weights[2]))
+      break;
+    triangleId = directionIndex.TriangleNeighbors[3*triangleId+corner];
+  }
+  return triangleId;
+}
 
 //---------------------------------------------------------------------------
 void vtkSlicerPETTumorSegmentationLogic::UpdateFingerPrint(vtkMRMLPETTumorSegmentationParametersNode* node)
@@ -1799,6 +2530,7 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateFingerPrint(vtkMRMLPETTumorSegmen
   {
     StrongWatershedVolume_saved = nullptr;
     WeakWatershedVolume_saved = nullptr;
+    ClearColumnSamples();
     centerFingerPrint.clear();
     return;
   }
@@ -1807,6 +2539,7 @@ void vtkSlicerPETTumorSegmentationLogic::UpdateFingerPrint(vtkMRMLPETTumorSegmen
   {
     StrongWatershedVolume_saved = nullptr;
     WeakWatershedVolume_saved = nullptr;
+    ClearColumnSamples();
     centerFingerPrint.resize(3);
     centerFingerPrint[0] = centerFingerPrint_node[0];
     centerFingerPrint[1] = centerFingerPrint_node[1];
@@ -1838,10 +2571,23 @@ bool vtkSlicerPETTumorSegmentationLogic::CheckFingerPrint(vtkMRMLPETTumorSegment
 vtkSlicerPETTumorSegmentationLogic::ScalarImageType::Pointer vtkSlicerPETTumorSegmentationLogic::GetPETVolume(vtkMRMLPETTumorSegmentationParametersNode* node)
 {
   //Converts the PET volume from reference to vtk volume to itk volume
-  ScalarImageType::Pointer petVolume = nullptr;
   vtkMRMLScene* slicerMrmlScene = qSlicerApplication::application()->mrmlScene();
   vtkMRMLScalarVolumeNode* vtkPetVolume = static_cast<vtkMRMLScalarVolumeNode*>(slicerMrmlScene->GetNodeByID( node->GetPETVolumeReference() ));
-  petVolume = convert2ITK<ScalarImageType>( vtkPetVolume->GetImageData() );
+  vtkImageData* petImageData = vtkPetVolume->GetImageData();
+
+  //Float volumes are used in place.  Other volumes are cast once and reused until the volume changes.
+  ScalarImageType::Pointer petVolume = import2ITK<ScalarImageType>( petImageData );
+  if (petVolume.IsNull())
+  {
+    vtkMTimeType petVolumeMTime = std::max( vtkPetVolume->GetMTime(), petImageData->GetMTime() );
+    if (PETVolumeCast_saved.IsNull() || PETVolumeCastSource_saved!=petImageData || PETVolumeCastMTime_saved!=petVolumeMTime)
+    {
+      PETVolumeCast_saved = convert2ITK<ScalarImageType>( petImageData );
+      PETVolumeCastSource_saved = petImageData;
+      PETVolumeCastMTime_saved = petVolumeMTime;
+    }
+    petVolume = PETVolumeCast_saved;
+  }
   petVolume->SetSpacing( vtkPetVolume->GetSpacing() );
   double origin2[3] = {-vtkPetVolume->GetOrigin()[0], -vtkPetVolume->GetOrigin()[1], vtkPetVolume->GetOrigin()[2]};
   petVolume->SetOrigin( origin2 );
@@ -1887,6 +2633,151 @@ vtkSlicerPETTumorSegmentationLogic::WatershedImageType::Pointer vtkSlicerPETTumo
   return weakWatershedVolume;
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::ValidateColumnSamples(vtkMRMLPETTumorSegmentationParametersNode* node)
+{
+  //The samples belong to the columns of one graph, which are determined by the PET volume and the center point.
+  //A new finger print clears them; the center point can additionally be moved by assist centering.
+  if (!CheckFingerPrint(node))
+  { UpdateFingerPrint(node);  }
+  PointType centerpoint = node->GetCenterpoint();
+  if (columnSamplesCenterpoint.size() == 0 || centerpoint[0] != columnSamplesCenterpoint[0] || centerpoint[1] != columnSamplesCenterpoint[1] || centerpoint[2] != columnSamplesCenterpoint[2])
+  {
+    ClearColumnSamples();
+    columnSamplesCenterpoint.assign(centerpoint.Begin(), centerpoint.End());
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::ClearColumnSamples()
+{
+  UptakeSamples_saved.Clear();
+  LabelRuns_saved.clear();
+  LabelCosts_saved.Clear();
+  StrongWatershedSamples_saved.Clear();
+  WeakWatershedSamples_saved.Clear();
+}
+
+//---------------------------------------------------------------------------
+const vtkSlicerPETTumorSegmentationLogic::ColumnSamplesType<float>& vtkSlicerPETTumorSegmentationLogic::GetUptakeSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
+{
+  ValidateColumnSamples(node);
+  if (UptakeSamples_saved.Offsets.size() != node->GetOSFGraph()->GetSurface()->GetNumberOfVertices()+1)
+  {
+    SampleColumnsLinear(node, petVolume, UptakeSamples_saved);
+  }
+  return UptakeSamples_saved;
+}
+
+//---------------------------------------------------------------------------
+const vtkSlicerPETTumorSegmentationLogic::ColumnLabelRunsType& vtkSlicerPETTumorSegmentationLogic::GetLabelRuns(vtkMRMLPETTumorSegmentationParametersNode* node, LabelImageType::Pointer initialLabelMap)
+{
+  ValidateColumnSamples(node);
+  if (LabelRuns_saved.size() != node->GetOSFGraph()->GetSurface()->GetNumberOfVertices())
+  {
+    SampleColumnsLabelRuns(node, initialLabelMap, LabelRuns_saved);
+  }
+  return LabelRuns_saved;
+}
+
+//---------------------------------------------------------------------------
+const vtkSlicerPETTumorSegmentationLogic::ColumnSamplesType<vtkSlicerPETTumorSegmentationLogic::WatershedPixelType>& vtkSlicerPETTumorSegmentationLogic::GetStrongWatershedSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
+{
+  ValidateColumnSamples(node);
+  if (StrongWatershedSamples_saved.Offsets.size() != node->GetOSFGraph()->GetSurface()->GetNumberOfVertices()+1)
+  {
+    WatershedInterpolatorType::Pointer strongWatershedInterpolator = WatershedInterpolatorType::New();
+    strongWatershedInterpolator->SetInputImage( GetStrongWatershedVolume(node, petVolume) );
+    SampleColumns<WatershedPixelType, WatershedInterpolatorType>(node, strongWatershedInterpolator, StrongWatershedSamples_saved);
+  }
+  return StrongWatershedSamples_saved;
+}
+
+//---------------------------------------------------------------------------
+const vtkSlicerPETTumorSegmentationLogic::ColumnSamplesType<vtkSlicerPETTumorSegmentationLogic::WatershedPixelType>& vtkSlicerPETTumorSegmentationLogic::GetWeakWatershedSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume)
+{
+  ValidateColumnSamples(node);
+  if (WeakWatershedSamples_saved.Offsets.size() != node->GetOSFGraph()->GetSurface()->GetNumberOfVertices()+1)
+  {
+    WatershedInterpolatorType::Pointer weakWatershedInterpolator = WatershedInterpolatorType::New();
+    weakWatershedInterpolator->SetInputImage( GetWeakWatershedVolume(node, petVolume) );
+    SampleColumns<WatershedPixelType, WatershedInterpolatorType>(node, weakWatershedInterpolator, WeakWatershedSamples_saved);
+  }
+  return WeakWatershedSamples_saved;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerPETTumorSegmentationLogic::OSFGraphType::Pointer
+vtkSlicerPETTumorSegmentationLogic::ReplayCostHistory(vtkMRMLPETTumorSegmentationParametersNode* node)
+{
+  OSFGraphType::Pointer graph = Clone(node->GetOSFGraph());
+  if (graph.IsNull())
+    return graph;
+
+  // the history links every refinement step to the preceding one, so it is replayed from its end
+  std::vector<vtkMRMLPETTumorSegmentationParametersNode::CostDeltaPointer> deltas;
+  for (vtkMRMLPETTumorSegmentationParametersNode::CostDeltaPointer delta = node->GetCostHistory(); delta; delta = delta->Previous)
+    deltas.push_back(delta);
+
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
+  for (auto deltaItr = deltas.rbegin(); deltaItr != deltas.rend(); ++deltaItr)
+  {
+    std::vector<float>::const_iterator costItr = (*deltaItr)->Costs.begin();
+    for (unsigned int vertexId : (*deltaItr)->VertexIds)
+    {
+      OSFSurfaceType::ColumnCostsSpan costs = surface->GetWritableColumnCostsSpan(vertexId);
+      std::copy(costItr, costItr+costs.size(), costs.begin());
+      costItr += costs.size();
+    }
+  }
+  return graph;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::RecordCostHistory(vtkMRMLPETTumorSegmentationParametersNode* node, OSFGraphType::Pointer previousGraph)
+{
+  OSFGraphType::Pointer graph = node->GetOSFGraph();
+  if (graph.IsNull() || previousGraph.IsNull())
+    return;
+
+  std::shared_ptr<vtkMRMLPETTumorSegmentationParametersNode::CostDeltaType> delta =
+    std::make_shared<vtkMRMLPETTumorSegmentationParametersNode::CostDeltaType>();
+  delta->Previous = node->GetCostHistory();
+
+  // a step without any changed column still gets its (empty) entry; shared cost buffers were not written at all
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
+  OSFSurfaceType::Pointer previousSurface = previousGraph->GetSurface();
+  bool sharedCosts = surface->GetColumnsPacked() && previousSurface->GetColumnsPacked() &&
+    &surface->GetPackedColumnCosts()==&previousSurface->GetPackedColumnCosts();
+  for (unsigned int vertexId=0; !sharedCosts && vertexId<surface->GetNumberOfVertices(); ++vertexId)
+  {
+    OSFSurfaceType::ConstColumnCostsSpan costs = surface->GetColumnCostsSpan(vertexId);
+    OSFSurfaceType::ConstColumnCostsSpan previousCosts = previousSurface->GetColumnCostsSpan(vertexId);
+    if (!std::equal(costs.begin(), costs.end(), previousCosts.begin()))
+    {
+      delta->VertexIds.push_back(vertexId);
+      delta->Costs.insert(delta->Costs.end(), costs.begin(), costs.end());
+    }
+  }
+  node->SetCostHistory(delta);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPETTumorSegmentationLogic::ReleaseRefinedCosts(vtkMRMLPETTumorSegmentationParametersNode* node, OSFGraphType::Pointer baseGraph)
+{
+  OSFGraphType::Pointer solvedGraph = node->GetOSFGraph();
+  if (solvedGraph.IsNull() || baseGraph.IsNull())
+    return;
+
+  // the copy shares the cost buffer of the base graph, so undo levels of the node only differ by the solution and the cost history
+  OSFGraphType::Pointer graph = Clone(baseGraph);
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
+  OSFSurfaceType::Pointer solvedSurface = solvedGraph->GetSurface();
+  for (unsigned int vertexId=0; vertexId<surface->GetNumberOfVertices(); ++vertexId)
+    surface->SetCurrentVertexPositionIdentifier(vertexId, solvedSurface->GetCurrentVertexPositionIdentifier(vertexId));
+  node->SetOSFGraph(graph);
+}
+
 //----------------------------------------------------------------------------
 vtkSlicerPETTumorSegmentationLogic::OSFGraphType::Pointer
 vtkSlicerPETTumorSegmentationLogic::Clone(OSFGraphType::Pointer graph)
@@ -30,6 +30,7 @@
 
 // ITK includes
 #include <itkImage.h>
+#include <itkImportImageContainer.h>
 #include <itkMesh.h>
 #include <itkLinearInterpolateImageFunction.h>
 #include <itkNearestNeighborInterpolateImageFunction.h>
@@ -41,11 +42,16 @@
 
 // OSF includes
 #include "itkOSFGraph.h"
+#include "itkLOGISMOSOSFGraphSolverFilter.h"
+#include "itkSimpleOSFGraphBuilderFilter.h"
+#include "itkLinearColumnSampler.h"
+#include "itkNearestNeighborColumnSampler.h"
 
 // MRML includes
 
 // STD includes
 #include <cstdlib>
+#include <memory>
 #include "vtkSlicerPETTumorSegmentationModuleLogicExport.h"
 class vtkMRMLPETTumorSegmentationParametersNode;
 
@@ -83,6 +89,12 @@ public:
   /** Called after making a local refinement point.  Changes the result in a narrow region. */
   void ApplyLocalRefinement(vtkMRMLPETTumorSegmentationParametersNode* node, vtkImageData* labelImageData);
   
+  /** Computes the segmentation surfaces for a range of thresholds and caches them in the parameter node, unless they are cached for the current settings.  Global refinement looks the surface up instead of solving if its threshold was swept. */
+  void ComputeThresholdSweep(vtkMRMLPETTumorSegmentationParametersNode* node, vtkImageData* labelImageData, int numberOfThresholds=32);
+  
+  /** Applies the cached surface of the threshold sweep closest to the given threshold, e.g. for a threshold slider.  Computes the sweep first if none is cached for the current settings.  Returns false if there is no sweep. */
+  bool ApplyThresholdSweep(vtkMRMLPETTumorSegmentationParametersNode* node, vtkImageData* labelImageData, float threshold);
+  
 protected:
   vtkSlicerPETTumorSegmentationLogic() = default;
   ~vtkSlicerPETTumorSegmentationLogic() override = default;
@@ -105,12 +117,81 @@ protected:
   using PointType = ScalarImageType::PointType;
   using RegionType = ScalarImageType::RegionType;
   using InterpolatorType = itk::LinearInterpolateImageFunction<ScalarImageType>;
-  using LabelInterpolatorType = itk::NearestNeighborInterpolateImageFunction<LabelImageType>;
+  using ColumnSamplerType = itk::LinearColumnSampler<ScalarImageType>;
+  using LabelColumnSamplerType = itk::NearestNeighborColumnSampler<LabelImageType>;
+  using LabelRunType = LabelColumnSamplerType::RunType;
+  using LabelRunsContainer = LabelColumnSamplerType::RunsContainer;
   using WatershedInterpolatorType = itk::NearestNeighborInterpolateImageFunction<WatershedImageType>;
   using OSFGraphType = itk::OSFGraph<float>;
   using OSFSurfaceType = OSFGraphType::OSFSurface;
+  using OSFGraphBuilderType = itk::SimpleOSFGraphBuilderFilter<OSFGraphType,OSFGraphType>;
+  using OSFGraphSolverType = itk::LOGISMOSOSFGraphSolverFilter<OSFGraphType,OSFGraphType>;
   using MeshType = itk::Mesh<float, 3>;
   using HistogramType = std::vector<float>;
+  template <typename valueType>
+  using ColumnSamplesSpan = OSFSurfaceType::ColumnSpan<const valueType>;
+  
+  /** Values of a volume sampled on all column nodes of the graph, as a dense matrix with one row per vertex. */
+  template <typename valueType>
+  struct ColumnSamplesType
+  {
+    std::vector<valueType> Values;     // rows of all vertices, concatenated
+    std::vector<unsigned int> Offsets; // start of the row of each vertex, followed by the total number of samples
+    ColumnSamplesSpan<valueType> GetColumn(int vertexId) const
+    { return ColumnSamplesSpan<valueType>( Values.data()+Offsets[vertexId], Offsets[vertexId+1]-Offsets[vertexId] ); }
+    OSFSurfaceType::ColumnSpan<valueType> GetWritableColumn(int vertexId)
+    { return OSFSurfaceType::ColumnSpan<valueType>( Values.data()+Offsets[vertexId], Offsets[vertexId+1]-Offsets[vertexId] ); }
+    void Clear()
+    { Values.clear(); Offsets.clear(); }
+  };
+  
+  /** Labels of a volume along all columns of the graph, as runs of equal labels with one container per vertex. */
+  using ColumnLabelRunsType = std::vector<LabelRunsContainer>;
+  
+  /** The mode flags of the parameter node that change the cost stages, as compile-time constants. */
+  template <bool paintOver, bool necroticRegion, bool splitting, bool linearCost>
+  struct CostModePolicy
+  {
+    static constexpr bool PaintOver = paintOver;
+    static constexpr bool NecroticRegion = necroticRegion;
+    static constexpr bool Splitting = splitting;
+    static constexpr bool LinearCost = linearCost;
+  };
+  
+  /** The samples read by the cost stages of all vertices.  The watershed samples are only set in splitting mode. */
+  struct CostStageInputsType
+  {
+    vtkMRMLPETTumorSegmentationParametersNode* Node{ nullptr };
+    const ColumnSamplesType<float>* UptakeSamples{ nullptr };
+    const ColumnLabelRunsType* LabelRuns{ nullptr };
+    const ColumnSamplesType<WatershedPixelType>* StrongWatershedSamples{ nullptr };
+    const ColumnSamplesType<WatershedPixelType>* WeakWatershedSamples{ nullptr };
+  };
+  
+  /** Column directions and triangles of the sphere graph template with a cube map over all directions for the closest vertex and triangle lookup.  Each cell of a cube face holds the vertex closest to the direction of the cell center and the triangle containing it. */
+  struct SphereDirectionIndexType
+  {
+    std::vector<PointType::VectorType> Directions; // unit direction of the column of each vertex
+    std::vector<PointType> FirstColumnPoints;      // first column point of each vertex, around the origin
+    std::vector<unsigned int> CellVertices;        // closest vertex of each cell, face by face in rows of cubeMapResolution cells
+    std::vector<unsigned int> CellTriangles;       // triangle containing the direction of the center of each cell
+    std::vector<unsigned int> TriangleVertices;    // three vertices of each triangle of the sphere mesh
+    std::vector<unsigned int> TriangleNeighbors;   // triangle across the edge opposite to each of the three vertices
+    std::vector<itk::Matrix<double,3,3>> TriangleWeights; // maps a direction to its weights of the directions of the three vertices
+  };
+  
+  /** Inputs of the voxelization of the solved surface, shared by all z-slices. */
+  struct VoxelizationInputsType
+  {
+    const SphereDirectionIndexType* DirectionIndex{ nullptr };
+    std::vector<double> InverseRadii;          // inverse distance of the surface from the center at each vertex
+    double MaximumSquaredRadius{ 0.0 };        // voxels further away from the center are outside
+    PointType Center;
+    RegionType Region;                         // region to voxelize
+    LabelImageType* Segmentation{ nullptr };
+    const LabelImageType* InitialLabelMap{ nullptr }; // voxels of other lesions in it are outside; nullptr to paint over them
+    short Label{ 0 };
+  };
   
   // methods for main processing steps
   /** Generates the graph and calculates the threshold. */
@@ -122,8 +203,8 @@ protected:
   /** Modifies the graph node costs based on the most recent local refinement point. */
   void UpdateGraphCostsLocally(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, bool renewOldPoints=false); // incorporate local refinement information
   
-  /** Completes final steps of segmentation, including solving and modifying the label map. */
-  void FinalizeOSFSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap); // update OSF segmentation and output
+  /** Completes final steps of segmentation, including solving (unless the graph already holds the solution) and modifying the label map. */
+  void FinalizeOSFSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap, bool solve=true); // update OSF segmentation and output
   
   // helper methods utilized by main processing steps
   /** Convertes the base label map from VTK to ITK.  Gets spacing information from the parameter node. */
@@ -141,6 +222,9 @@ protected:
   /** Gets the center point from the fiducial list into the parameter node.  Returns false if the center point is out of bounds or nonexistant. */
   bool CalculateCenterPoint(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap);
   
+  /** Returns the region of the image covering the bounding box of the mesh sphere around the center plus a one voxel margin, cropped to the image. */
+  RegionType GetSphereRegion(vtkMRMLPETTumorSegmentationParametersNode* node, const itk::ImageBase<3>* image);
+
   /** Returns the subvolume of the PET image around the center. */
   ScalarImageType::Pointer ExtractPETSubVolume(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume);
   
@@ -159,11 +243,11 @@ protected:
   /** Completes the maximum flow step of the solution algorithm. */
   void MaxFlow(vtkMRMLPETTumorSegmentationParametersNode* node);
   
-  /** Returns the solution mesh for the segmentation. */
-  MeshType::Pointer GetSegmentationMesh(vtkMRMLPETTumorSegmentationParametersNode* node);
+  /** Returns the voxelization of the solved surface minus any culling.  Only voxels 6-connected to the center voxel are inside. */
+  LabelImageType::Pointer GetSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, LabelImageType::Pointer initialLabelMap);
   
-  /** Returns the voxelization of the mesh minus any culling. */
-  LabelImageType::Pointer GetSegmentation(vtkMRMLPETTumorSegmentationParametersNode* node, MeshType::Pointer mesh, LabelImageType::Pointer initialLabelMap);
+  /** Voxelizes a z-slice of the region of the solved surface, which is star-shaped around the center. */
+  static void VoxelizeSurfaceSlice(int z, const VoxelizationInputsType* inputs);
   
   /** Updates the output (labelmap or segmentation) to include the newly made segmentation.*/
   void UpdateOutput(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer segmentation, LabelImageType::Pointer initialLabelMap);
@@ -173,19 +257,40 @@ protected:
   
   /** Calculates the threshold in the parameter node based on the global refinement point's location. */
   void CalculateThresholdPointLocationBased(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume);
+  
+  /** Sets the graph node costs for the threshold in the parameter node, without the effect of a global refinement point. */
+  void SetGraphCostsForThreshold(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, LabelImageType::Pointer initialLabelMap);
+  
+  /** Sets the solution on the graph from the cached threshold sweep, if it holds the solution for the current costs.  Returns false if the max flow has to be computed. */
+  bool LookupThresholdSweep(vtkMRMLPETTumorSegmentationParametersNode* node);
+  
+  /** Returns a key of the settings besides the threshold that influence the graph costs, to recognize outdated threshold sweeps. */
+  std::size_t GetThresholdSweepSettingsKey(vtkMRMLPETTumorSegmentationParametersNode* node);
+  
+  /** Returns the index of the threshold of the sweep closest to the given threshold.  The sweep must not be empty. */
+  static size_t GetClosestThresholdSweepIndex(const vtkMRMLPETTumorSegmentationParametersNode::ThresholdSweepType& sweep, float threshold);
+  
+  /** Returns a copy of the graph in the parameter node with the costs of its cost history replayed on the base costs. */
+  OSFGraphType::Pointer ReplayCostHistory(vtkMRMLPETTumorSegmentationParametersNode* node);
+  
+  /** Appends the columns whose costs in the parameter node's graph differ from the previous graph to the cost history. */
+  void RecordCostHistory(vtkMRMLPETTumorSegmentationParametersNode* node, OSFGraphType::Pointer previousGraph);
+  
+  /** Replaces the solved graph in the parameter node by a copy of the base graph with the solution, so the node only keeps the base costs. */
+  void ReleaseRefinedCosts(vtkMRMLPETTumorSegmentationParametersNode* node, OSFGraphType::Pointer baseGraph);
     
   // methods for local refinement node selection
   /** Finds the closest vertex to the target point p. */
   int GetClosestVertex(vtkMRMLPETTumorSegmentationParametersNode* node, const PointType& p);
   
-  /** Finds the closest column on a vertex to the target point p. */
+  /** Finds the closest column on a vertex to the target point p.  The column is straight with evenly spaced points, so this is the rounded projection onto it. */
   int GetClosestColumnOnVertex(vtkMRMLPETTumorSegmentationParametersNode* node, const PointType& p, int vertexId);
   
   /** Adds the cost change from the most recent local refinement step. */
   void AddLocalRefinementCosts(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume, const PointType& refinementPoint, std::vector<bool> depth0ModifiedOverall, std::vector<bool> depth0ModifiedSequence);
   
   /** Finds the array of uptakes within range that best matches the initial template.*/
-  int GetBestTemplateMatch(std::vector<float> vecTemplate, int idxTemplate, int len, std::vector<float> vecB, int range, float& matchingScore);
+  int GetBestTemplateMatch(ColumnSamplesSpan<float> vecTemplate, int idxTemplate, int len, ColumnSamplesSpan<float> vecB, int range, float& matchingScore);
   
   // finger print-based methods to reduce memory use in MRML node and reduce time remaking utility volumes
   /** Updates the local finger print variables to reflect the parameter node. */
@@ -203,31 +308,111 @@ protected:
   /** Returns the weak watershed volume.  Generates it, if needed, otherwise uses the local copy. */
   WatershedImageType::Pointer GetWeakWatershedVolume(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume);
   
+  /** Clears the local column samples if they were taken for another PET volume or center point than the one of the parameter node. */
+  void ValidateColumnSamples(vtkMRMLPETTumorSegmentationParametersNode* node);
+  
+  /** Clears all local column samples. */
+  void ClearColumnSamples();
+  
+  /** Returns the PET uptake on all column nodes.  Samples it, if needed, otherwise uses the local copy. */
+  const ColumnSamplesType<float>& GetUptakeSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume);
+  
+  /** Returns the runs of the initial labels along all columns.  Samples them, if needed, otherwise uses the local copy. */
+  const ColumnLabelRunsType& GetLabelRuns(vtkMRMLPETTumorSegmentationParametersNode* node, LabelImageType::Pointer initialLabelMap);
+  
+  /** Returns the strong watershed labels on all column nodes.  Samples them, if needed, otherwise uses the local copy. */
+  const ColumnSamplesType<WatershedPixelType>& GetStrongWatershedSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume);
+  
+  /** Returns the weak watershed labels on all column nodes.  Samples them, if needed, otherwise uses the local copy. */
+  const ColumnSamplesType<WatershedPixelType>& GetWeakWatershedSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer petVolume);
+  
   // utility methods for multi-threading
   /** Determines the median uptake at a certain shell level and sets it in the parameter node. */
-  static void GetMedianUptakeForShell(int shellId, vtkMRMLPETTumorSegmentationParametersNode* node, std::vector<float>& shellUptakes, InterpolatorType::Pointer interpolator);
+  static void GetMedianUptakeForShell(int shellId, vtkMRMLPETTumorSegmentationParametersNode* node, std::vector<float>& shellUptakes, const ColumnSamplesType<float>* uptakeSamples);
+  
+  /** Selects the cost mode policy for the mode flags, one flag at a time, and sets the graph costs with the cost stages specialized for it. */
+  template <bool... modeFlags, typename... remainingModeFlagTypes>
+  void SetGraphCostsForModeFlags(const CostStageInputsType& inputs, bool modeFlag, remainingModeFlagTypes... remainingModeFlags);
+  template <bool... modeFlags>
+  void SetGraphCostsForModeFlags(const CostStageInputsType& inputs);
+  
+  /** Sets the base costs and adds the label costs and the other cost adjustments based on no refinement to the graph, with the cost stages specialized for the mode policy. */
+  template <class ModePolicy>
+  void SetGraphCostsForMode(const CostStageInputsType& inputs);
   
-  /** Sets the base cost and adds cost adjustments based on no refinement to the graph at the vertex.  Requires the parameter node and interpolators for the PET image, label volume, and watershed volumes. */
-  static void SetGlobalGraphCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, InterpolatorType::Pointer interpolator, LabelInterpolatorType::Pointer labelInterpolator, WatershedInterpolatorType::Pointer strongWatershedInterpolator, WatershedInterpolatorType::Pointer weakWatershedInterpolator);
+  /** Returns the label avoidance or default necrotic costs of all column nodes.  Calculates them, if needed, otherwise uses the local copy. */
+  template <class ModePolicy>
+  const ColumnSamplesType<float>& GetLabelCosts(const CostStageInputsType& inputs);
   
-  /** Sets the costs on the graph at the vertex based on the threshold calculated.  Requires the parameter node and the uptake at the nodes. */
-  static void SetGlobalBaseGraphCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, const std::vector<float>& uptakeValues);
+  /** Sets the label avoidance or default necrotic costs of the vertex into its row of the label costs.  Requires the parameter node, the samples of the PET image and the label runs. */
+  template <class ModePolicy>
+  static void SetLabelCostsForVertex(int vertexId, const CostStageInputsType* inputs, ColumnSamplesType<float>* labelCosts);
   
-  /** Adds the costs at the vertex for label avoidance.  Requires the parameter node, the uptake at the nodes, and an interpolator for the label volume. */
-  static void AddLabelAvoidanceCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, const std::vector<float>& uptakeValues, LabelInterpolatorType::Pointer labelInterpolator);
+  /** Adds the threshold dependent cost adjustments based on no refinement besides the base costs to the graph at the vertex.  Requires the parameter node, the samples of the PET image and the samples of the watershed volumes (only used in splitting mode). */
+  template <class ModePolicy>
+  static void SetGlobalGraphCostsForVertex(int vertexId, const CostStageInputsType* inputs);
   
-  /** Adds the necrotic costs for no label avoidance to the vertex of choice.  Requires the parameter node and an interpolator for the label volume. */
-  static void AddDefaultNecroticCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, LabelInterpolatorType::Pointer labelInterpolator);
+  /** Sets the costs on the graph at all vertices based on the threshold calculated, in one vectorizable pass over the uptake samples.  Writes into the packed costs of the graph if its columns match the samples.  Requires the parameter node and the uptake at the nodes. */
+  template <class ModePolicy>
+  static void SetGlobalBaseGraphCosts(vtkMRMLPETTumorSegmentationParametersNode* node, const ColumnSamplesType<float>& uptakeSamples);
   
-  /** Adds the costs to the parameter node's graph for splitting mode to the vertex of choice.  Requires the parameter node, uptake values and interpolators for the strong and weak watershed volumes. */
-  static void AddSplittingCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, const std::vector<float>& uptakeValues, WatershedInterpolatorType::Pointer strongWatershedInterpolator, WatershedInterpolatorType::Pointer weakWatershedInterpolator);
+  /** Adds the costs of a column for label avoidance to costs.  Requires the parameter node, the uptake at the nodes, and the label runs along the column. */
+  template <class ModePolicy>
+  static void AddLabelAvoidanceCostsForVertex(vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplesSpan<float> uptakeValues, const LabelRunsContainer& labelRuns, OSFSurfaceType::ColumnCostsSpan costs);
+  
+  /** Adds the necrotic costs of a column for no label avoidance to costs.  Requires the parameter node and the label runs along the column. */
+  static void AddDefaultNecroticCostsForVertex(vtkMRMLPETTumorSegmentationParametersNode* node, const LabelRunsContainer& labelRuns, OSFSurfaceType::ColumnCostsSpan costs);
+  
+  /** Returns the first node at or after firstNode whose label is neither background nor the given label, or the maximum unsigned int if there is none. */
+  static unsigned int GetFirstOtherLabelNode(const LabelRunsContainer& labelRuns, int label, unsigned int firstNode);
+  
+  /** Adds the costs to the parameter node's graph for splitting mode to the vertex of choice.  Requires the parameter node, uptake values and the strong and weak watershed labels at the nodes. */
+  static void AddSplittingCostsForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplesSpan<float> uptakeValues, ColumnSamplesSpan<WatershedPixelType> strongWatershedValues, ColumnSamplesSpan<WatershedPixelType> weakWatershedValues);
+  
+  /** Samples the image at each of the nodes on the given column into its row of the samples, given the parameter node and the interpolator of choice. */
+  template <typename valueType, class ImageInterpolatorType>
+  static void SampleColumnPoints(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, typename ImageInterpolatorType::Pointer interpolator, ColumnSamplesType<valueType>* samples);
   
-  /** Samples the uptake at each of the nodes on the given column, given the parameter node and the interpolator of choice. */
+  /** Samples the image at all nodes of all columns in parallel. */
   template <typename valueType, class ImageInterpolatorType>
-  static std::vector<valueType> SampleColumnPoints(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, typename ImageInterpolatorType::Pointer interpolator, valueType defaultValue=0);
+  static void SampleColumns(vtkMRMLPETTumorSegmentationParametersNode* node, typename ImageInterpolatorType::Pointer interpolator, ColumnSamplesType<valueType>& samples);
   
-  /** Builds the indexed column on the graph contained in the parameter node. */
-  static void BuildColumnForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node);
+  /** Samples the image with linear interpolation at each of the nodes on the given column into its row of the samples, given the parameter node and the column sampler. */
+  static void SampleColumnPointsLinear(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplerType::ConstPointer sampler, ColumnSamplesType<float>* samples);
+  
+  /** Samples the image with linear interpolation at all nodes of all columns in parallel.  Gives the same values as SampleColumns with a linear interpolator, but steps along the straight columns. */
+  static void SampleColumnsLinear(vtkMRMLPETTumorSegmentationParametersNode* node, ScalarImageType::Pointer image, ColumnSamplesType<float>& samples);
+  
+  /** Samples the label image with nearest neighbor interpolation along the given column into its label runs, given the parameter node and the column sampler. */
+  static void SampleColumnLabelRuns(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node, LabelColumnSamplerType::ConstPointer sampler, ColumnLabelRunsType* labelRuns);
+  
+  /** Samples the label image along all columns in parallel.  The runs give the same labels as SampleColumns with a nearest neighbor interpolator, but only read the image once per voxel passed. */
+  static void SampleColumnsLabelRuns(vtkMRMLPETTumorSegmentationParametersNode* node, LabelImageType::Pointer image, ColumnLabelRunsType& labelRuns);
+  
+  /** Sizes the samples for all nodes of all columns of the graph in the parameter node. */
+  template <typename valueType>
+  static void AllocateColumnSamples(vtkMRMLPETTumorSegmentationParametersNode* node, ColumnSamplesType<valueType>& samples);
+  
+  /** Builds the indexed column from the origin on the sphere graph template. */
+  static void BuildColumnForVertex(int vertexId, OSFGraphType* graph);
+  
+  /** Moves the indexed column of the graph contained in the parameter node from the origin to the center point. */
+  static void TranslateColumnForVertex(int vertexId, vtkMRMLPETTumorSegmentationParametersNode* node);
+  
+  /** Returns the graph of the sphere mesh with columns around the origin, built once and shared by all segmentations. */
+  static OSFGraphType::ConstPointer GetSphereGraphTemplate();
+  
+  /** Returns the direction index of the sphere graph template, built once with it. */
+  static const SphereDirectionIndexType& GetSphereDirectionIndex();
+  
+  /** Returns the cube map cell of a direction. */
+  static unsigned int GetCubeMapCell(const PointType::VectorType& direction);
+  
+  /** Returns the triangle of the sphere graph template containing a direction by walking from the given triangle, and the weights of the direction. */
+  static unsigned int GetTriangleOfDirection(const SphereDirectionIndexType& directionIndex, const PointType::VectorType& direction, unsigned int triangleId, PointType::VectorType& weights);
+  
+  /** Returns the sphere graph template with the nodes and edges of the graph builder, built once per soft smoothness penalty. */
+  static OSFGraphType::ConstPointer GetGraphBuilderTemplate(double softSmoothnessPenalty);
   
   /** Makes a deep copy of the graph object. */
   static OSFGraphType::Pointer Clone(OSFGraphType::Pointer graph);
@@ -240,6 +425,27 @@ private:
   template <class ITKImageType>
   typename ITKImageType::Pointer convert2ITK(vtkSmartPointer<vtkImageData> vtkVolume);
 
+  /** Pixel container using the scalars of a VTK volume in place.  It keeps a reference to the VTK volume, so the scalars stay valid as long as an ITK volume uses them. */
+  template <typename TPixel>
+  class VTKScalarsPixelContainer : public itk::ImportImageContainer<itk::SizeValueType, TPixel>
+  {
+  public:
+    using Self = VTKScalarsPixelContainer;
+    using Pointer = itk::SmartPointer<Self>;
+    itkNewMacro( Self );
+    itkTypeMacro( VTKScalarsPixelContainer, ImportImageContainer );
+    void SetImageData(vtkImageData* imageData) { ImageData = imageData; }
+  protected:
+    VTKScalarsPixelContainer() = default;
+    ~VTKScalarsPixelContainer() override = default;
+  private:
+    vtkSmartPointer<vtkImageData> ImageData;
+  };
+
+  /** Wraps a VTK volume as an ITK volume without copying the scalars, nullptr if the scalar type does not match.  The ITK volume must not be written. */
+  template <class ITKImageType>
+  typename ITKImageType::Pointer import2ITK(vtkImageData* vtkVolume);
+
   /** Converts a VTK float/double array to an ITK point. */
   PointType convert2ITK(const double* coordinate);
   
@@ -262,6 +468,9 @@ private:
   /** Determines the density of the spherical mesh.  At density of 4, there are 1026 vertices. */
   static constexpr int meshResolution = 4;
   
+  /** Number of cells along each edge of a face of the cube map of the sphere direction index.  With 16x16 cells per face, a cell is about as wide as the spacing of the vertices, so the closest vertex is only a few neighbor steps away from the one of the cell. */
+  static constexpr int cubeMapResolution = 16;
+  
   /** Determines the radius of the spherical mesh.  60 mm is sufficiently large for the vast majority of cases. */
   static constexpr float meshSphereRadius = 60.0f;
   
@@ -304,12 +513,41 @@ private:
   /** The coordinates of the most recent center point.  Stored to recognize when watershed volumes need not be recalculated. */
   std::vector<float> centerFingerPrint;
   
+  /** The PET volume cast to float, the VTK volume it was cast from and the modification time of the volume then.  Saved so that PET volumes that are not stored as float are only cast once instead of on every click. */
+  ScalarImageType::Pointer PETVolumeCast_saved;
+  vtkSmartPointer<vtkImageData> PETVolumeCastSource_saved;
+  vtkMTimeType PETVolumeCastMTime_saved{ 0 };
+  
   /** A pointer to the most recent strong watershed volume.  Saved to avoid lengthy recalculation when it is avoidable. */
   WatershedImageType::Pointer StrongWatershedVolume_saved;
   
   /** A pointer to the most recent weak watershed volume.  Saved to avoid lengthy recalculation when it is avoidable. */
   WatershedImageType::Pointer WeakWatershedVolume_saved;
   
+  /** The samples of the PET volume, runs of the initial label map and samples of the watershed volumes on the columns of the most recent graph.  Saved so that all cost stages and refinements read the same matrices instead of interpolating the volumes again. */
+  ColumnSamplesType<float> UptakeSamples_saved;
+  ColumnLabelRunsType LabelRuns_saved;
+  ColumnSamplesType<WatershedPixelType> StrongWatershedSamples_saved;
+  ColumnSamplesType<WatershedPixelType> WeakWatershedSamples_saved;
+  
+  /** The label avoidance or default necrotic costs of the most recent graph.  Saved so that global refinements, which only change the threshold, only recalculate the threshold dependent costs. */
+  ColumnSamplesType<float> LabelCosts_saved;
+  
+  /** The label, modes, lower uptake bound and, for label avoidance in necrotic mode, threshold the label costs were calculated for. */
+  std::vector<float> labelCostsFingerPrint;
+  
+  /** The coordinates of the center point of the graph the column samples were taken on. */
+  std::vector<double> columnSamplesCenterpoint;
+  
+  /** The max flow solver of the most recent solution.  Kept alive so that refinements only apply the capacity changes to its flow and search trees instead of solving from scratch. */
+  OSFGraphSolverType::Pointer OSFGraphSolver_saved;
+  
+  /** The graph builder of the most recent solution.  Kept alive so that local refinements only update the nodes of the columns they changed. */
+  OSFGraphBuilderType::Pointer OSFGraphBuilder_saved;
+  
+  /** The cost history of the graph of the most recent solution, empty if the solution does not belong to a cost history.  A graph replayed from it has the costs the saved builder and solver were last updated with.  Only used for its identity, and kept alive so that it cannot be mistaken for a later history. */
+  std::shared_ptr<const void> SolvedCostHistory_saved;
+  
 };
 
 #endif
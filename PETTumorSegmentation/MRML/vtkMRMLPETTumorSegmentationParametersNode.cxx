@@ -42,6 +42,8 @@ void vtkMRMLPETTumorSegmentationParametersNode::Clear()
 {
   this->OSFGraph = nullptr;
   this->InitialLabelMap = nullptr;
+  this->ThresholdSweep = nullptr;
+  this->CostHistory = nullptr;
   Histogram.clear();
 }
 
@@ -86,6 +88,8 @@ void vtkMRMLPETTumorSegmentationParametersNode::Copy(vtkMRMLNode *anode)
     vtkMRMLCopyFloatMacro(HistogramMedian);
     vtkMRMLCopyFloatMacro(CenterpointUptake);
     vtkMRMLCopyFloatMacro(Threshold);
+    this->SetThresholdSweep(node->GetThresholdSweep());
+    this->SetCostHistory(node->GetCostHistory());
 
     vtkMRMLCopyEndMacro();
   }
@@ -40,6 +40,7 @@
 #include "../Logic/itkOSFGraph.h"
 
 // STL includes
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -151,6 +152,24 @@ class VTK_SLICER_PETTUMORSEGMENTATION_MODULE_MRML_EXPORT vtkMRMLPETTumorSegmenta
   using WatershedPixelType = unsigned long;
   using WatershedImageType = itk::Image<WatershedPixelType, 3>;
 
+  /** Segmentation surfaces precomputed for a range of thresholds (see vtkSlicerPETTumorSegmentationLogic::ComputeThresholdSweep). */
+  struct ThresholdSweepType
+  {
+    std::vector<float> Thresholds;                    ///< ascending thresholds
+    std::vector< std::vector<unsigned int> > Surfaces; ///< column position of every vertex for each threshold
+    std::size_t SettingsKey{ 0 };                     ///< refinement settings the surfaces were computed with
+  };
+  using ThresholdSweepPointer = std::shared_ptr<const ThresholdSweepType>;
+
+  /** Column costs changed by one refinement step, replayed on the base costs of the graph (see vtkSlicerPETTumorSegmentationLogic::ReplayCostHistory). */
+  struct CostDeltaType
+  {
+    std::shared_ptr<const CostDeltaType> Previous; ///< delta of the preceding refinement step, nullptr for the first step after the base costs
+    std::vector<unsigned int> VertexIds;           ///< vertices whose column costs changed
+    std::vector<float> Costs;                      ///< new costs of the changed columns, concatenated in the order of VertexIds
+  };
+  using CostDeltaPointer = std::shared_ptr<const CostDeltaType>;
+
   void SetCenterpoint(PointType index) {Centerpoint = index;};
   PointType GetCenterpoint() {return Centerpoint;};
   float GetCenterpointX() { return Centerpoint[0];};
@@ -175,6 +194,14 @@ class VTK_SLICER_PETTUMORSEGMENTATION_MODULE_MRML_EXPORT vtkMRMLPETTumorSegmenta
   void SetOSFGraph(GraphType::Pointer graph) {OSFGraph = graph;};
   GraphType::Pointer GetOSFGraph() {return OSFGraph;};
 
+  void SetThresholdSweep(ThresholdSweepPointer sweep) {ThresholdSweep = sweep;};
+  ThresholdSweepPointer GetThresholdSweep() {return ThresholdSweep;};
+  void ClearThresholdSweep() {ThresholdSweep = nullptr;};
+
+  void SetCostHistory(CostDeltaPointer history) {CostHistory = history;};
+  CostDeltaPointer GetCostHistory() {return CostHistory;};
+  void ClearCostHistory() {CostHistory = nullptr;};
+
   void SetInitialLabelMap(LabelImageType::Pointer labelMap) {InitialLabelMap = labelMap;};
   LabelImageType::Pointer GetInitialLabelMap() {return InitialLabelMap;};
   void ClearInitialLabelMap() {InitialLabelMap = nullptr;};
@@ -249,7 +276,7 @@ class VTK_SLICER_PETTUMORSEGMENTATION_MODULE_MRML_EXPORT vtkMRMLPETTumorSegmenta
   /** The intial label map before starting a segmentation of the current lesion. */
   LabelImageType::Pointer InitialLabelMap{ nullptr };
 
-  /** The graph structure with all costs and edges.*/
+  /** The graph structure with the base costs and the current solution; the refined costs are replayed from the cost history.*/
   GraphType::Pointer OSFGraph{ nullptr };
 
   /** The histogram of the region around the center.*/
@@ -267,6 +294,12 @@ class VTK_SLICER_PETTUMORSEGMENTATION_MODULE_MRML_EXPORT vtkMRMLPETTumorSegmenta
   /** The threshold currently in use for cost setting.*/
   float Threshold;
 
+  /** The cached threshold sweep for the current graph and refinement points, shared between copies of the node.*/
+  ThresholdSweepPointer ThresholdSweep{ nullptr };
+
+  /** The latest column cost changes of the refinement steps since the base costs of the graph were set, shared between copies of the node.*/
+  CostDeltaPointer CostHistory{ nullptr };
+
 private:
   // for debugging
   std::string VolumeInfo(vtkMRMLScalarVolumeNode* volume);
@@ -0,0 +1,465 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+// Benchmark of the max flow engines and graph layouts on the OSF sphere graph used by the PET tumor segmentation
+// (resolution 4 icosphere -> 1026 columns with 60 nodes each, hard smoothness constraint 5).
+
+// ITK includes
+#include <itkMesh.h>
+#include <itkRegularSphereMeshSource.h>
+#include <itkTimeProbe.h>
+
+// OSF includes
+#include "itkOSFGraph.h"
+#include "itkMeshToOSFGraphFilter.h"
+#include "itkSimpleOSFGraphBuilderFilter.h"
+#include "logismos_solver.hxx"
+#include "logismos_push_relabel.hxx"
+#include "logismos_pseudoflow.hxx"
+#include "logismos_implicit_push_relabel.hxx"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// counts the allocations of the graphs of the BK engine, which use CountingAllocator; only differences are reported
+unsigned long allocationCount = 0;
+
+//----------------------------------------------------------------------------
+// Stateless allocator counting its allocations, the graph rebinds it for all its containers.
+template <typename T>
+struct CountingAllocator
+{
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(std::size_t n)
+  {
+    allocationCount++;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* ptr, std::size_t n)
+  {
+    std::allocator<T>().deallocate(ptr, n);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&) { return false; }
+
+using MeshType = itk::Mesh<float, 3>;
+using OSFGraphType = itk::OSFGraph<float>;
+using OSFSurfaceType = OSFGraphType::OSFSurface;
+using MaxFlowGraphType = LOGISMOS::solver<OSFGraphType::GraphCosts>;
+
+const int meshResolution = 4;
+const float meshSphereRadius = 60.0f;
+const int numberOfSteps = 60;
+const unsigned int hardSmoothnessConstraint = 5;
+const double softSmoothnessPenalty = 0.005;
+const int numberOfRepetitions = 5;
+
+//----------------------------------------------------------------------------
+// Builds the sphere graph like vtkSlicerPETTumorSegmentationLogic::CreateGraph and fills the columns with the
+// costs of a lobulated blob, then runs the graph builder.
+OSFGraphType::Pointer CreateSphereGraph()
+{
+  using RegularSphereMeshSourceType = itk::RegularSphereMeshSource<MeshType>;
+  RegularSphereMeshSourceType::Pointer sphereMeshSource = RegularSphereMeshSourceType::New();
+  RegularSphereMeshSourceType::PointType sphereCenter;
+  sphereCenter.Fill(0.0);
+  RegularSphereMeshSourceType::VectorType sphereRadius;
+  sphereRadius.Fill(meshSphereRadius);
+  sphereMeshSource->SetCenter( sphereCenter );
+  sphereMeshSource->SetScale( sphereRadius );
+  sphereMeshSource->SetResolution( meshResolution );
+
+  using MeshToOSFGraphFilterType = itk::MeshToOSFGraphFilter<MeshType, OSFGraphType>;
+  MeshToOSFGraphFilterType::Pointer meshToOSFGraphFilter = MeshToOSFGraphFilterType::New();
+  meshToOSFGraphFilter->SetInput( sphereMeshSource->GetOutput() );
+  meshToOSFGraphFilter->Update();
+  OSFGraphType::Pointer graph = meshToOSFGraphFilter->GetOutput();
+
+  OSFSurfaceType::Pointer surface = graph->GetSurface();
+  for (OSFSurfaceType::VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+  {
+    OSFSurfaceType::CoordinateType::VectorType direction = surface->GetInitialVertexPosition( vertexId )-sphereCenter;
+    direction.Normalize();
+    const float boundary = 20.0f + 6.0f*std::sin(3.0f*direction[0]) + 4.0f*std::cos(5.0f*direction[1]*direction[2]);
+
+    OSFSurfaceType::ColumnCoordinatesContainer::Pointer columnPositions = OSFSurfaceType::ColumnCoordinatesContainer::New();
+    OSFSurfaceType::ColumnCostsContainer::Pointer columnCosts = OSFSurfaceType::ColumnCostsContainer::New();
+    columnPositions->CreateIndex( numberOfSteps-1 );
+    columnCosts->CreateIndex( numberOfSteps-1 );
+    for (int step=0; step<numberOfSteps; step++)
+    {
+      columnPositions->SetElement( step, sphereCenter + direction*float(step+1) );
+      columnCosts->SetElement( step, std::fabs(float(step+1)-boundary)/numberOfSteps + 0.02f*std::sin(0.7f*step+vertexId) );
+    }
+    surface->SetColumnCoordinates( vertexId, columnPositions );
+    surface->SetColumnCosts( vertexId, columnCosts );
+    surface->SetInitialVertexPositionIdentifier( vertexId, 0 );
+  }
+
+  using GraphBuilderType = itk::SimpleOSFGraphBuilderFilter<OSFGraphType, OSFGraphType>;
+  GraphBuilderType::Pointer graphBuilder = GraphBuilderType::New();
+  graphBuilder->SetInput( graph );
+  graphBuilder->SetSmoothnessConstraint( hardSmoothnessConstraint );
+  graphBuilder->SetSoftSmoothnessPenalty( softSmoothnessPenalty );
+  graphBuilder->Update();
+  return graphBuilder->GetOutput();
+}
+
+//----------------------------------------------------------------------------
+// Transfers the OSF graph into a max flow graph the same way LOGISMOSOSFGraphSolverFilter does.
+void BuildMaxFlowGraph(const OSFGraphType* osfGraph, MaxFlowGraphType& maxFlowGraph)
+{
+  const OSFGraphType::GraphNodesContainer* graphNodes = osfGraph->GetNodes();
+  const OSFGraphType::GraphEdgesContainer* graphEdges = osfGraph->GetEdges();
+
+  maxFlowGraph.add_nodes( graphNodes->Size() );
+  for (OSFGraphType::GraphNodesContainer::ConstIterator itr=graphNodes->Begin(); itr!=graphNodes->End(); ++itr)
+    maxFlowGraph.add_st_edge( itr.Index(), itr.Value().cap_source, itr.Value().cap_sink );
+
+  if (maxFlowGraph.counts_edges())
+  {
+    for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+      maxFlowGraph.count_edge( itr.Value().startNodeId, itr.Value().endNodeId );
+    maxFlowGraph.allocate_edges();
+  }
+  for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+    maxFlowGraph.add_edge( itr.Value().startNodeId, itr.Value().endNodeId, itr.Value().cap, itr.Value().rev_cap );
+}
+
+//----------------------------------------------------------------------------
+// Transfers the OSF graph into the implicit arc engine the same way LOGISMOSOSFGraphSolverFilter does, the edges of the
+// OSF graph are not used (all columns of the sphere graph have the same size and nodes are ordered by column).
+void BuildImplicitMaxFlowGraph(const OSFGraphType* osfGraph, LOGISMOS::implicit_push_relabel<OSFGraphType::GraphCosts>& maxFlowGraph)
+{
+  const OSFSurfaceType* surface = osfGraph->GetSurface();
+  for (OSFSurfaceType::VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+    maxFlowGraph.add_column( surface->GetNumberOfColumns(vertexId) );
+  for (OSFSurfaceType::VertexIdentifier vertexId=0; vertexId<surface->GetNumberOfVertices(); vertexId++)
+  {
+    const OSFSurfaceType::VertexIdentifierContainer* neighbors = surface->GetNeighbors(vertexId);
+    for (OSFSurfaceType::VertexIdentifierContainer::ConstIterator neighborItr=neighbors->Begin(); neighborItr!=neighbors->End(); ++neighborItr)
+      maxFlowGraph.add_column_neighbor( vertexId, neighborItr.Value() );
+  }
+
+  const OSFGraphType::GraphNodesContainer* graphNodes = osfGraph->GetNodes();
+  for (OSFGraphType::GraphNodesContainer::ConstIterator itr=graphNodes->Begin(); itr!=graphNodes->End(); ++itr)
+    maxFlowGraph.add_st_edge( itr.Index(), itr.Value().cap_source, itr.Value().cap_sink );
+  maxFlowGraph.allocate_edges();
+}
+
+//----------------------------------------------------------------------------
+enum Engine
+{
+  ChunkedBoykovKolmogorov,
+  PackedBoykovKolmogorov,
+  PushRelabel,
+  Pseudoflow,
+  ImplicitPushRelabel
+};
+
+//----------------------------------------------------------------------------
+MaxFlowGraphType* CreateMaxFlowGraph(Engine engine)
+{
+  switch (engine)
+  {
+    case PushRelabel:
+      return new LOGISMOS::push_relabel<OSFGraphType::GraphCosts>();
+    case Pseudoflow:
+      return new LOGISMOS::pseudoflow<OSFGraphType::GraphCosts>();
+    case ImplicitPushRelabel:
+      return new LOGISMOS::implicit_push_relabel<OSFGraphType::GraphCosts>( hardSmoothnessConstraint, OSFGraphType::GraphCosts(softSmoothnessPenalty) );
+    case PackedBoykovKolmogorov:
+      return new LOGISMOS::bk_solver< OSFGraphType::GraphCosts, CountingAllocator<OSFGraphType::GraphCosts> >(true);
+    case ChunkedBoykovKolmogorov:
+    default:
+      return new LOGISMOS::bk_solver< OSFGraphType::GraphCosts, CountingAllocator<OSFGraphType::GraphCosts> >(false);
+  }
+}
+
+//----------------------------------------------------------------------------
+struct EngineResult
+{
+  bool allocationsCounted{ false }; // only the graphs of the BK engine use CountingAllocator
+  unsigned long allocations{ 0 };
+  itk::TimeProbe buildProbe;
+  itk::TimeProbe solveProbe;
+  OSFGraphType::GraphCosts flow{ 0 };
+  std::vector<bool> sourceSet;
+};
+
+//----------------------------------------------------------------------------
+void BenchmarkEngine(const OSFGraphType* osfGraph, Engine engine, EngineResult& result)
+{
+  result.allocationsCounted = (engine==ChunkedBoykovKolmogorov || engine==PackedBoykovKolmogorov);
+  for (int repetition=0; repetition<numberOfRepetitions; repetition++)
+  {
+    unsigned long allocationsBefore = allocationCount;
+    result.buildProbe.Start();
+    MaxFlowGraphType* maxFlowGraph = CreateMaxFlowGraph(engine);
+    if (engine==ImplicitPushRelabel)
+      BuildImplicitMaxFlowGraph(osfGraph, *static_cast<LOGISMOS::implicit_push_relabel<OSFGraphType::GraphCosts>*>(maxFlowGraph));
+    else
+      BuildMaxFlowGraph(osfGraph, *maxFlowGraph);
+    result.buildProbe.Stop();
+    result.allocations = allocationCount-allocationsBefore;
+
+    result.solveProbe.Start();
+    result.flow = maxFlowGraph->solve();
+    result.solveProbe.Stop();
+
+    result.sourceSet.resize( maxFlowGraph->get_node_cnt() );
+    for (std::size_t nodeId=0; nodeId<maxFlowGraph->get_node_cnt(); nodeId++)
+      result.sourceSet[nodeId] = maxFlowGraph->in_source_set(nodeId);
+    delete maxFlowGraph;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Solves the same topology repeatedly like LOGISMOSOSFGraphSolverFilter with KeepMaxFlowGraph: the graph is built
+// once, afterwards only flow and capacities are reset.
+void BenchmarkReset(const OSFGraphType* osfGraph, EngineResult& result)
+{
+  result.allocationsCounted = true;
+  MaxFlowGraphType* maxFlowGraph = CreateMaxFlowGraph(PackedBoykovKolmogorov);
+  BuildMaxFlowGraph(osfGraph, *maxFlowGraph);
+  maxFlowGraph->solve();
+
+  const OSFGraphType::GraphNodesContainer* graphNodes = osfGraph->GetNodes();
+  const OSFGraphType::GraphEdgesContainer* graphEdges = osfGraph->GetEdges();
+  for (int repetition=0; repetition<numberOfRepetitions; repetition++)
+  {
+    unsigned long allocationsBefore = allocationCount;
+    result.buildProbe.Start();
+    maxFlowGraph->reset();
+    for (OSFGraphType::GraphNodesContainer::ConstIterator itr=graphNodes->Begin(); itr!=graphNodes->End(); ++itr)
+      maxFlowGraph->add_st_edge( itr.Index(), itr.Value().cap_source, itr.Value().cap_sink );
+    for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+      maxFlowGraph->set_edge( 2*itr.Index(), itr.Value().cap, itr.Value().rev_cap );
+    result.buildProbe.Stop();
+    result.allocations = allocationCount-allocationsBefore;
+
+    result.solveProbe.Start();
+    result.flow = maxFlowGraph->solve();
+    result.solveProbe.Stop();
+  }
+
+  result.sourceSet.resize( maxFlowGraph->get_node_cnt() );
+  for (std::size_t nodeId=0; nodeId<maxFlowGraph->get_node_cnt(); nodeId++)
+    result.sourceSet[nodeId] = maxFlowGraph->in_source_set(nodeId);
+  delete maxFlowGraph;
+}
+
+//----------------------------------------------------------------------------
+// Changes random terminal and edge capacities of a solved graph like LOGISMOSOSFGraphSolverFilter with ReuseSearchTrees
+// and solves again reusing the search trees, the cut has to match a fresh solve of the changed capacities.
+bool CheckIncrementalSolve(const OSFGraphType* osfGraph, Engine engine)
+{
+  using CapacityType = OSFGraphType::GraphCosts;
+  const OSFGraphType::GraphNodesContainer* graphNodes = osfGraph->GetNodes();
+  const OSFGraphType::GraphEdgesContainer* graphEdges = osfGraph->GetEdges();
+  std::vector<CapacityType> sourceCapacities, sinkCapacities, edgeCapacities, edgeReverseCapacities;
+  for (OSFGraphType::GraphNodesContainer::ConstIterator itr=graphNodes->Begin(); itr!=graphNodes->End(); ++itr)
+  {
+    sourceCapacities.push_back( itr.Value().cap_source );
+    sinkCapacities.push_back( itr.Value().cap_sink );
+  }
+  for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+  {
+    edgeCapacities.push_back( itr.Value().cap );
+    edgeReverseCapacities.push_back( itr.Value().rev_cap );
+  }
+
+  MaxFlowGraphType* maxFlowGraph = CreateMaxFlowGraph(engine);
+  BuildMaxFlowGraph(osfGraph, *maxFlowGraph);
+  maxFlowGraph->solve();
+
+  std::mt19937 randomGenerator(42);
+  std::uniform_real_distribution<CapacityType> change(-0.05, 0.05);
+  std::uniform_real_distribution<double> selection(0.0, 1.0);
+  bool sameCut = true;
+  for (int repetition=0; repetition<numberOfRepetitions && sameCut; repetition++)
+  {
+    // unchanged sides are passed as 0, the infinite capacities of the hard constraints stay unchanged
+    for (std::size_t nodeId=0; nodeId<sourceCapacities.size(); nodeId++)
+    {
+      if (selection(randomGenerator)>0.1)
+        continue;
+      const CapacityType sourceCapacity = std::max( CapacityType(0), sourceCapacities[nodeId]+change(randomGenerator) );
+      const CapacityType sinkCapacity = std::max( CapacityType(0), sinkCapacities[nodeId]+change(randomGenerator) );
+      maxFlowGraph->update_st_edge( nodeId, sourceCapacity-sourceCapacities[nodeId], sinkCapacity-sinkCapacities[nodeId] );
+      sourceCapacities[nodeId] = sourceCapacity;
+      sinkCapacities[nodeId] = sinkCapacity;
+    }
+    for (std::size_t edgeId=0; edgeId<edgeCapacities.size(); edgeId++)
+    {
+      if (selection(randomGenerator)>0.1)
+        continue;
+      CapacityType capacityChanges[2] = { 0, 0 };
+      CapacityType* capacities[2] = { &edgeCapacities[edgeId], &edgeReverseCapacities[edgeId] };
+      for (int side=0; side<2; side++)
+      {
+        if (std::isinf(*capacities[side]))
+          continue;
+        const CapacityType capacity = std::max( CapacityType(0), *capacities[side]+change(randomGenerator) );
+        capacityChanges[side] = capacity-*capacities[side];
+        *capacities[side] = capacity;
+      }
+      maxFlowGraph->update_edge( 2*edgeId, capacityChanges[0], capacityChanges[1] );
+    }
+    maxFlowGraph->resolve();
+
+    MaxFlowGraphType* freshMaxFlowGraph = CreateMaxFlowGraph(engine);
+    freshMaxFlowGraph->add_nodes( sourceCapacities.size() );
+    for (std::size_t nodeId=0; nodeId<sourceCapacities.size(); nodeId++)
+      freshMaxFlowGraph->add_st_edge( nodeId, sourceCapacities[nodeId], sinkCapacities[nodeId] );
+    if (freshMaxFlowGraph->counts_edges())
+    {
+      for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+        freshMaxFlowGraph->count_edge( itr.Value().startNodeId, itr.Value().endNodeId );
+      freshMaxFlowGraph->allocate_edges();
+    }
+    for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+      freshMaxFlowGraph->add_edge( itr.Value().startNodeId, itr.Value().endNodeId, edgeCapacities[itr.Index()], edgeReverseCapacities[itr.Index()] );
+    freshMaxFlowGraph->solve();
+
+    for (std::size_t nodeId=0; nodeId<sourceCapacities.size(); nodeId++)
+      if (maxFlowGraph->in_source_set(nodeId)!=freshMaxFlowGraph->in_source_set(nodeId))
+        sameCut = false;
+    delete freshMaxFlowGraph;
+  }
+  delete maxFlowGraph;
+  return sameCut;
+}
+
+//----------------------------------------------------------------------------
+// Sums the capacities of the OSF graph edges cut by the source set. The engines may choose different cuts of the
+// same energy, and with float capacities residuals close to zero are saturated differently (BK sets residuals below
+// epsilon to zero), so the engines are compared by the energy of their cuts.
+double CutEnergy(const OSFGraphType* osfGraph, const std::vector<bool>& sourceSet)
+{
+  const OSFGraphType::GraphNodesContainer* graphNodes = osfGraph->GetNodes();
+  const OSFGraphType::GraphEdgesContainer* graphEdges = osfGraph->GetEdges();
+  double energy = 0.0;
+  for (OSFGraphType::GraphNodesContainer::ConstIterator itr=graphNodes->Begin(); itr!=graphNodes->End(); ++itr)
+    energy += sourceSet[itr.Index()] ? itr.Value().cap_sink : itr.Value().cap_source;
+  for (OSFGraphType::GraphEdgesContainer::ConstIterator itr=graphEdges->Begin(); itr!=graphEdges->End(); ++itr)
+  {
+    const bool startInSourceSet = sourceSet[itr.Value().startNodeId];
+    const bool endInSourceSet = sourceSet[itr.Value().endNodeId];
+    if (startInSourceSet && !endInSourceSet)
+      energy += itr.Value().cap;
+    else if (!startInSourceSet && endInSourceSet)
+      energy += itr.Value().rev_cap;
+  }
+  return energy;
+}
+
+//----------------------------------------------------------------------------
+// The cut energies are sums of tens of thousands of float capacities, so they are compared with a relative tolerance.
+bool SameCutEnergy(double energy, double referenceEnergy)
+{
+  return std::isfinite(energy) && std::fabs(energy-referenceEnergy) <= 1e-4*std::max(1.0, std::fabs(referenceEnergy));
+}
+
+//----------------------------------------------------------------------------
+void PrintEngineResult(const char* name, const EngineResult& result)
+{
+  std::cout << name << ": ";
+  if (result.allocationsCounted)
+    std::cout << result.allocations << " allocations, ";
+  std::cout << "build " << result.buildProbe.GetMean() << " s, solve " << result.solveProbe.GetMean()
+            << " s, flow " << result.flow << std::endl;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int LOGISMOSGraphBenchmark(int itkNotUsed(argc), char* itkNotUsed(argv)[])
+{
+  OSFGraphType::Pointer osfGraph = CreateSphereGraph();
+  std::cout << "OSF graph: " << osfGraph->GetNumberOfNodes() << " nodes, " << osfGraph->GetNumberOfEdges() << " edges" << std::endl;
+
+  EngineResult chunked;
+  EngineResult packed;
+  EngineResult pushRelabel;
+  EngineResult pseudoflow;
+  EngineResult implicitPushRelabel;
+  EngineResult packedReset;
+  BenchmarkEngine(osfGraph, ChunkedBoykovKolmogorov, chunked);
+  BenchmarkEngine(osfGraph, PackedBoykovKolmogorov, packed);
+  BenchmarkEngine(osfGraph, PushRelabel, pushRelabel);
+  BenchmarkEngine(osfGraph, Pseudoflow, pseudoflow);
+  BenchmarkEngine(osfGraph, ImplicitPushRelabel, implicitPushRelabel);
+  BenchmarkReset(osfGraph, packedReset);
+  PrintEngineResult("BK, chunked edges", chunked);
+  PrintEngineResult("BK, packed edges ", packed);
+  PrintEngineResult("push-relabel     ", pushRelabel);
+  PrintEngineResult("pseudoflow (HPF) ", pseudoflow);
+  PrintEngineResult("implicit arcs    ", implicitPushRelabel);
+  PrintEngineResult("BK, packed, reset", packedReset);
+
+  if (chunked.sourceSet!=packed.sourceSet)
+  {
+    std::cerr << "Packed edge storage produced a different minimum cut." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const double chunkedEnergy = CutEnergy(osfGraph, chunked.sourceSet);
+  if (!SameCutEnergy(CutEnergy(osfGraph, pushRelabel.sourceSet), chunkedEnergy))
+  {
+    std::cerr << "Push-relabel engine produced a cut of a different energy." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!SameCutEnergy(CutEnergy(osfGraph, pseudoflow.sourceSet), chunkedEnergy))
+  {
+    std::cerr << "Pseudoflow engine produced a cut of a different energy." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!SameCutEnergy(CutEnergy(osfGraph, implicitPushRelabel.sourceSet), chunkedEnergy))
+  {
+    std::cerr << "Implicit arc engine produced a cut of a different energy." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (chunked.sourceSet!=packedReset.sourceSet)
+  {
+    std::cerr << "Reset graph produced a different minimum cut." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckIncrementalSolve(osfGraph, ChunkedBoykovKolmogorov) || !CheckIncrementalSolve(osfGraph, PackedBoykovKolmogorov))
+  {
+    std::cerr << "Solving again after capacity changes produced a different minimum cut than a fresh solve." << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
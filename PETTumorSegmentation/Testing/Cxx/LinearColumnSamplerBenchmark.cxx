@@ -0,0 +1,196 @@
+/*==============================================================================
+
+ Program: PETTumorSegmentation
+
+ (c) Copyright University of Iowa All Rights Reserved.
+
+ See COPYRIGHT.txt
+ or http://www.slicer.org/copyright/copyright.txt for details.
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ==============================================================================*/
+
+// Benchmark of the column sampler against the linear interpolator on the columns of the OSF sphere graph used by the
+// PET tumor segmentation (resolution 4 icosphere -> 1026 columns with 60 nodes each, 1 mm apart), partly outside of
+// an anisotropic PET-like volume.
+
+// ITK includes
+#include <itkImage.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkMesh.h>
+#include <itkRegularSphereMeshSource.h>
+#include <itkTimeProbe.h>
+
+// OSF includes
+#include "itkLinearColumnSampler.h"
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+using ImageType = itk::Image<float, 3>;
+using MeshType = itk::Mesh<float, 3>;
+using PointType = MeshType::PointType;
+using ColumnType = std::vector<PointType>;
+using InterpolatorType = itk::LinearInterpolateImageFunction<ImageType>;
+using ColumnSamplerType = itk::LinearColumnSampler<ImageType>;
+
+const int meshResolution = 4;
+const int numberOfSteps = 60;
+const int numberOfRepetitions = 10;
+const double maximumDifference = 1e-3;
+
+//----------------------------------------------------------------------------
+// Creates a volume with 4x4x3 mm voxels and a few smooth blobs of uptake, the origin and direction are not trivial.
+ImageType::Pointer CreateImage()
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::SizeType size;
+  size[0] = 64;
+  size[1] = 64;
+  size[2] = 48;
+  ImageType::RegionType region;
+  region.SetSize( size );
+  image->SetRegions( region );
+  ImageType::SpacingType spacing;
+  spacing[0] = 4.0;
+  spacing[1] = 4.0;
+  spacing[2] = 3.0;
+  image->SetSpacing( spacing );
+  ImageType::PointType origin;
+  origin[0] = -120.0;
+  origin[1] = 80.0;
+  origin[2] = -40.0;
+  image->SetOrigin( origin );
+  ImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[1][1] = -1.0;
+  image->SetDirection( direction );
+  image->Allocate();
+
+  for (itk::IndexValueType z=0; z<itk::IndexValueType(size[2]); z++)
+    for (itk::IndexValueType y=0; y<itk::IndexValueType(size[1]); y++)
+      for (itk::IndexValueType x=0; x<itk::IndexValueType(size[0]); x++)
+      {
+        ImageType::IndexType index = {{ x, y, z }};
+        const float value = 8.0f*std::exp( -0.004f*float((x-20)*(x-20)+(y-30)*(y-30)+(z-20)*(z-20)) )
+          + 3.0f*std::exp( -0.02f*float((x-28)*(x-28)+(y-24)*(y-24)+(z-26)*(z-26)) )
+          + 0.5f + 0.1f*std::sin(0.9f*x+0.4f*y+1.3f*z);
+        image->SetPixel( index, value );
+      }
+  return image;
+}
+
+//----------------------------------------------------------------------------
+// Builds the straight columns of the sphere graph like vtkSlicerPETTumorSegmentationLogic::BuildColumnForVertex around a
+// center close to the border of the image, and a jittered copy of every tenth column that has to be sampled node by node.
+std::vector<ColumnType> CreateColumns(const ImageType* image)
+{
+  using RegularSphereMeshSourceType = itk::RegularSphereMeshSource<MeshType>;
+  RegularSphereMeshSourceType::Pointer sphereMeshSource = RegularSphereMeshSourceType::New();
+  PointType sphereCenter;
+  sphereCenter.Fill(0.0);
+  RegularSphereMeshSourceType::VectorType sphereRadius;
+  sphereRadius.Fill(1.0);
+  sphereMeshSource->SetCenter( sphereCenter );
+  sphereMeshSource->SetScale( sphereRadius );
+  sphereMeshSource->SetResolution( meshResolution );
+  sphereMeshSource->Update();
+  const MeshType* sphereMesh = sphereMeshSource->GetOutput();
+
+  ImageType::IndexType centerIndex = {{ 20, 30, 40 }};
+  ImageType::PointType center;
+  image->TransformIndexToPhysicalPoint( centerIndex, center );
+
+  std::vector<ColumnType> columns;
+  for (MeshType::PointIdentifier pointId=0; pointId<sphereMesh->GetNumberOfPoints(); pointId++)
+  {
+    MeshType::VectorType direction = sphereMesh->GetPoint(pointId)-sphereCenter;
+    direction.Normalize();
+    ColumnType column(numberOfSteps);
+    for (int step=0; step<numberOfSteps; step++)
+      for (unsigned int d=0; d<3; d++)
+        column[step][d] = float(center[d]) + direction[d]*float(step+1);
+    columns.push_back(column);
+
+    if (pointId%10==0)
+    {
+      for (int step=0; step<numberOfSteps; step++)
+        column[step][0] += 0.3f*std::sin(0.5f*step);
+      columns.push_back(column);
+    }
+  }
+  return columns;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int LinearColumnSamplerBenchmark(int itkNotUsed(argc), char* itkNotUsed(argv)[])
+{
+  ImageType::Pointer image = CreateImage();
+  std::vector<ColumnType> columns = CreateColumns(image);
+  std::cout << "Columns: " << columns.size() << " with " << numberOfSteps << " nodes each" << std::endl;
+
+  // interpolator per node, as in vtkSlicerPETTumorSegmentationLogic::SampleColumnPoints
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage( image );
+  std::vector<float> interpolatorValues( columns.size()*numberOfSteps, 0.0f );
+  itk::TimeProbe interpolatorProbe;
+  for (int repetition=0; repetition<numberOfRepetitions; repetition++)
+  {
+    interpolatorProbe.Start();
+    for (std::size_t columnId=0; columnId<columns.size(); columnId++)
+      for (int step=0; step<numberOfSteps; step++)
+      {
+        const PointType& point = columns[columnId][step];
+        if ( interpolator->IsInsideBuffer(point) )
+          interpolatorValues[columnId*numberOfSteps+step] = interpolator->Evaluate(point);
+      }
+    interpolatorProbe.Stop();
+  }
+
+  ColumnSamplerType::Pointer sampler = ColumnSamplerType::New();
+  sampler->SetInputImage( image );
+  std::vector<float> samplerValues( columns.size()*numberOfSteps, 0.0f );
+  itk::TimeProbe samplerProbe;
+  for (int repetition=0; repetition<numberOfRepetitions; repetition++)
+  {
+    samplerProbe.Start();
+    for (std::size_t columnId=0; columnId<columns.size(); columnId++)
+      sampler->SampleColumn( columns[columnId].data(), numberOfSteps, samplerValues.data()+columnId*numberOfSteps );
+    samplerProbe.Stop();
+  }
+
+  std::cout << "linear interpolator: " << interpolatorProbe.GetMean() << " s" << std::endl;
+  std::cout << "column sampler     : " << samplerProbe.GetMean() << " s" << std::endl;
+
+  std::size_t numberOfOutsideNodes = 0;
+  for (std::size_t i=0; i<interpolatorValues.size(); i++)
+  {
+    if (interpolatorValues[i]==0.0f)
+      numberOfOutsideNodes++;
+    if (std::fabs(interpolatorValues[i]-samplerValues[i])>maximumDifference)
+    {
+      std::cerr << "Column sampler differs from the linear interpolator at node " << i << ": "
+                << samplerValues[i] << " instead of " << interpolatorValues[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (numberOfOutsideNodes==0)
+  {
+    std::cerr << "No column leaves the image, the bounds are not tested." << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}